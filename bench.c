@@ -0,0 +1,82 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "board.h"
+#include "search.h"
+
+#define DEFAULT_DEPTH 16
+#define DEFAULT_MAX_THREADS 32
+
+// opening, middlegame and king endgame positions
+static const char *bench_positions[] = {
+  NULL,
+  "B:W18,19,21,23,24,26,29,30,31,32:B1,2,3,4,6,7,9,10,11,12",
+  "W:W9,13,18,21,22,25,26,30:B1,3,5,7,10,14,15,16,20",
+  "B:W14,17,22,23,26,27,28,31:B2,5,6,8,10,11,12,16",
+  "W:WK14,K22,28:BK3,K7,12",
+};
+#define BENCH_POSITION_COUNT (int)(sizeof(bench_positions) / sizeof(bench_positions[0]))
+
+int main(int argc, char **argv) {
+  int depth = argc > 1 ? atoi(argv[1]) : DEFAULT_DEPTH;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_threads = argc > 2 ? atoi(argv[2]) : (cores > DEFAULT_MAX_THREADS ? cores : DEFAULT_MAX_THREADS);
+  size_t hash_mb = argc > 3 ? strtoul(argv[3], NULL, 10) : DEFAULT_HASH_MB;
+  if (depth < 1 || max_threads < 1) {
+    fprintf(stderr, "usage: %s [depth] [max threads] [hash MB]\n", argv[0]);
+    return 2;
+  }
+  if (!search_init(hash_mb)) {
+    fprintf(stderr, "could not allocate a %zu MB hash table\n", hash_mb);
+    return 1;
+  }
+  printf("time to depth %d over %d positions, %ld cores online\n\n",
+         depth, BENCH_POSITION_COUNT, cores);
+  printf("%7s %10s %14s %10s %10s %10s %10s %6s %11s\n", "threads", "time (s)", "nodes", "Mnodes/s", "speedup",
+         "nps scale", "quiesce %", "ebf", "first cut %");
+
+  double base_time = 0;
+  double base_nps = 0;
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    double elapsed = 0;
+    uint64_t nodes = 0;
+    uint64_t quiescence_nodes = 0;
+    uint64_t cutoffs = 0;
+    uint64_t first_move_cutoffs = 0;
+    // averaged over the positions
+    double branching_factor = 0;
+    for (int i = 0; i < BENCH_POSITION_COUNT; i++) {
+      GameState game;
+      game_init(&game);
+      if (bench_positions[i] && !game_set_fen(&game, bench_positions[i])) {
+        fprintf(stderr, "invalid bench position %s\n", bench_positions[i]);
+        return 1;
+      }
+      // every run starts cold so thread counts are compared fairly
+      search_clear_hash();
+      SearchLimits limits = {.max_depth = depth, .threads = threads};
+      SearchResult result;
+      if (search(&game, limits, &result)) {
+        elapsed += result.elapsed;
+        nodes += result.nodes;
+        quiescence_nodes += result.quiescence_nodes;
+        cutoffs += result.cutoffs;
+        first_move_cutoffs += result.first_move_cutoffs;
+        branching_factor += result.branching_factor / BENCH_POSITION_COUNT;
+      }
+    }
+    double nps = elapsed > 0 ? nodes / elapsed : 0;
+    if (threads == 1) {
+      base_time = elapsed;
+      base_nps = nps;
+    }
+    printf("%7d %10.3f %14llu %10.2f %10.2f %10.2f %10.1f %6.2f %11.1f\n", threads, elapsed,
+           (unsigned long long)nodes, nps / 1e6,
+           elapsed > 0 ? base_time / elapsed : 0, base_nps > 0 ? nps / base_nps : 0,
+           nodes > 0 ? 100.0 * quiescence_nodes / nodes : 0, branching_factor,
+           cutoffs > 0 ? 100.0 * first_move_cutoffs / cutoffs : 0);
+    fflush(stdout);
+  }
+  return 0;
+}
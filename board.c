@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include "board.h"
+#include "zobrist.h"
+
+void player_init(Player *p, int start_row) {
+  p->men = EMPTY_BOARD;
+  p->kings = EMPTY_BOARD;
+  p->selected_piece = -1;
+  p->is_computer = false;
+  for (int r = start_row; r < start_row + 3; r++) {
+    for (int c = 0; c < BOARD_SIZE; c++) {
+      if ((r + c) % 2 == 1) {
+        p->men |= SQUARE_BIT(square_from_position((Position) {c, r}));
+      }
+    }
+  }
+}
+
+void game_init(GameState *game) {
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    int start_row = (i == PLAYER_ONE) ? 0 : 5;
+    player_init(&game->players[i], start_row);
+  }
+  game->is_game_over = false;
+  // start with black colored checkers
+  game->current_player = START_PLAYER_IDX;
+  zobrist_init();
+  game->hash = compute_hash(game);
+}
+
+bool is_initial_position(const GameState *game) {
+  GameState initial;
+  game_init(&initial);
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    if (game->players[i].men != initial.players[i].men ||
+        game->players[i].kings != initial.players[i].kings) {
+      return false;
+    }
+  }
+  return game->current_player == initial.current_player;
+}
+
+int square_from_position(Position pos) {
+  if (pos.x < 0 || pos.x >= BOARD_SIZE || pos.y < 0 || pos.y >= BOARD_SIZE) {
+    return -1;
+  }
+  // only dark squares are part of the board
+  if ((pos.x + pos.y) % 2 != 1) {
+    return -1;
+  }
+  return pos.y * 4 + pos.x / 2;
+}
+
+Position position_from_square(int sq) {
+  int y = sq / 4;
+  int x = (sq % 4) * 2 + ((y % 2 == 0) ? 1 : 0);
+  return (Position) {x, y};
+}
+
+// parses one ",K12,13-16" style piece list up to the next ':' or end of string
+static bool parse_fen_pieces(Player *p, const char **cursor) {
+  const char *s = *cursor;
+  while (*s && *s != ':' && *s != '"') {
+    if (*s == ',') {
+      s++;
+      continue;
+    }
+    bool is_king = false;
+    if (*s == 'K') {
+      is_king = true;
+      s++;
+    }
+    int first = 0;
+    while (*s >= '0' && *s <= '9') {
+      first = first * 10 + (*s++ - '0');
+    }
+    int last = first;
+    if (*s == '-') {
+      s++;
+      last = 0;
+      while (*s >= '0' && *s <= '9') {
+        last = last * 10 + (*s++ - '0');
+      }
+    }
+    if (first < 1 || last > SQUARE_COUNT || first > last) {
+      return false;
+    }
+    for (int n = first; n <= last; n++) {
+      Bitboard b = SQUARE_BIT(square_from_pdn(n));
+      if (is_king) {
+        p->kings |= b;
+      } else {
+        p->men |= b;
+      }
+    }
+  }
+  *cursor = s;
+  return true;
+}
+
+bool game_set_fen(GameState *game, const char *fen) {
+  GameState parsed = {0};
+  const char *s = fen;
+  while (*s == '"' || *s == ' ') {
+    s++;
+  }
+  if (*s == 'W') {
+    parsed.current_player = PLAYER_ONE;
+  } else if (*s == 'B') {
+    parsed.current_player = PLAYER_TWO;
+  } else {
+    return false;
+  }
+  s++;
+  // one section per colour, in either order
+  int sections = 0;
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    if (*s++ != ':') {
+      return false;
+    }
+    int player_idx;
+    if (*s == 'W') {
+      player_idx = PLAYER_ONE;
+    } else if (*s == 'B') {
+      player_idx = PLAYER_TWO;
+    } else {
+      return false;
+    }
+    if (sections & (1 << player_idx)) {
+      return false;
+    }
+    sections |= 1 << player_idx;
+    s++;
+    if (!parse_fen_pieces(&parsed.players[player_idx], &s)) {
+      return false;
+    }
+  }
+  // a square holds one piece, of one side and either a man or a king
+  if (occupied_squares(&parsed) != (player_pieces(&parsed.players[PLAYER_ONE]) ^
+                                    player_pieces(&parsed.players[PLAYER_TWO]))) {
+    return false;
+  }
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    if (parsed.players[i].men & parsed.players[i].kings) {
+      return false;
+    }
+  }
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    parsed.players[i].selected_piece = -1;
+    // a man never stands on its own crowning row
+    parsed.players[i].kings |= parsed.players[i].men & promotion_row(i);
+    parsed.players[i].men &= ~promotion_row(i);
+  }
+  zobrist_init();
+  parsed.hash = compute_hash(&parsed);
+  *game = parsed;
+  return true;
+}
+
+void game_format_fen(const GameState *game, char *buf, size_t size) {
+  static const char sides[PLAYER_COUNT] = {'W', 'B'};
+  size_t written = snprintf(buf, size, "%c", sides[game->current_player]);
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    const Player *p = &game->players[i];
+    bool first = true;
+    written += snprintf(buf + written, written < size ? size - written : 0, ":%c", sides[i]);
+    // pieces in PDN square order, which runs opposite to the bit order
+    for (int n = 1; n <= SQUARE_COUNT; n++) {
+      Bitboard b = SQUARE_BIT(square_from_pdn(n));
+      if (!(player_pieces(p) & b)) {
+        continue;
+      }
+      written += snprintf(buf + written, written < size ? size - written : 0, "%s%s%d",
+                          first ? "" : ",", (p->kings & b) ? "K" : "", n);
+      first = false;
+    }
+  }
+}
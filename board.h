@@ -0,0 +1,163 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PLAYER_CHECKER_COUNT 12
+#define PLAYER_COUNT 2
+#define START_PLAYER_IDX 1
+#define PLAYER_ONE 0
+#define PLAYER_TWO 1
+#define BOARD_SIZE 8
+#define SQUARE_COUNT 32
+// a single move can at most capture every enemy piece
+#define MAX_JUMP_COUNT PLAYER_CHECKER_COUNT
+
+// one bit per dark square, square = y * 4 + x / 2
+// so bit 0 is (1, 0) and bit 31 is (6, 7)
+typedef uint32_t Bitboard;
+
+#define EMPTY_BOARD ((Bitboard)0)
+#define EVEN_ROWS ((Bitboard)0x0F0F0F0F)
+#define ODD_ROWS ((Bitboard)0xF0F0F0F0)
+// squares that still have a neighbour towards x + 1 / x - 1 after the shift
+#define EVEN_ROWS_NOT_RIGHT ((Bitboard)0x07070707)
+#define ODD_ROWS_NOT_LEFT ((Bitboard)0xE0E0E0E0)
+#define SQUARE_BIT(sq) ((Bitboard)1 << (sq))
+
+typedef struct Position {
+  int x;
+  int y;
+}Position;
+
+typedef enum PieceType {
+  PAWN,
+  KING,
+} PieceType;
+
+typedef enum Direction {
+  UP,
+  DOWN
+} Direction;
+
+typedef enum Diagonal {
+  UP_LEFT,
+  UP_RIGHT,
+  DOWN_LEFT,
+  DOWN_RIGHT,
+  DIAGONAL_COUNT
+} Diagonal;
+
+typedef struct Player {
+  Bitboard men;
+  Bitboard kings;
+  // square of the selected piece or -1
+  int selected_piece;
+  // moves are chosen by the search engine instead of the mouse
+  bool is_computer;
+}Player;
+
+typedef struct GameState {
+  Player players[PLAYER_COUNT];
+  bool is_game_over;
+  int current_player;
+  // zobrist key of the pieces and side to move, kept up to date by make_move
+  uint64_t hash;
+} GameState;
+
+void game_init(GameState *game);
+// loads a PDN FEN tag such as "B:W21,22,23:BK1,2-4"
+// white in PDN is PLAYER_ONE, black is PLAYER_TWO and moves first
+bool game_set_fen(GameState *game, const char *fen);
+// writes game as a FEN tag value, e.g. "B:W21,22,K23:B1,2"
+void game_format_fen(const GameState *game, char *buf, size_t size);
+// same pieces and side to move as the position game_init sets up
+bool is_initial_position(const GameState *game);
+
+int square_from_position(Position pos);
+Position position_from_square(int sq);
+
+// PDN numbers squares 1-32 starting from black's back row
+static inline int square_to_pdn(int sq) {
+  return SQUARE_COUNT - sq;
+}
+
+static inline int square_from_pdn(int n) {
+  return SQUARE_COUNT - n;
+}
+
+// UP moves towards y + 1, DOWN towards y - 1
+static inline Bitboard shift_up_left(Bitboard b) {
+  return ((b & EVEN_ROWS) << 4) | ((b & ODD_ROWS_NOT_LEFT) << 3);
+}
+
+static inline Bitboard shift_up_right(Bitboard b) {
+  return ((b & EVEN_ROWS_NOT_RIGHT) << 5) | ((b & ODD_ROWS) << 4);
+}
+
+static inline Bitboard shift_down_left(Bitboard b) {
+  return ((b & EVEN_ROWS) >> 4) | ((b & ODD_ROWS_NOT_LEFT) >> 5);
+}
+
+static inline Bitboard shift_down_right(Bitboard b) {
+  return ((b & EVEN_ROWS_NOT_RIGHT) >> 3) | ((b & ODD_ROWS) >> 4);
+}
+
+static inline Bitboard shift_diagonal(Bitboard b, Diagonal d) {
+  switch (d) {
+    case UP_LEFT: return shift_up_left(b);
+    case UP_RIGHT: return shift_up_right(b);
+    case DOWN_LEFT: return shift_down_left(b);
+    default: return shift_down_right(b);
+  }
+}
+
+static inline Diagonal opposite_diagonal(Diagonal d) {
+  return (Diagonal)(DIAGONAL_COUNT - 1 - d);
+}
+
+static inline int enemy_of(int player_idx) {
+  return player_idx ^ 1;
+}
+
+static inline Direction player_direction(int player_idx) {
+  return (player_idx == PLAYER_ONE) ? UP : DOWN;
+}
+
+// row a player's men are crowned on
+static inline Bitboard promotion_row(int player_idx) {
+  return (player_idx == PLAYER_ONE) ? (Bitboard)0xF0000000 : (Bitboard)0x0000000F;
+}
+
+static inline Bitboard player_pieces(const Player *p) {
+  return p->men | p->kings;
+}
+
+static inline Bitboard occupied_squares(const GameState *game) {
+  return player_pieces(&game->players[PLAYER_ONE]) |
+         player_pieces(&game->players[PLAYER_TWO]);
+}
+
+// same pieces and side to move, the hash rejects almost every mismatch
+static inline bool same_position(const GameState *a, const GameState *b) {
+  return a->hash == b->hash &&
+         a->current_player == b->current_player &&
+         a->players[PLAYER_ONE].men == b->players[PLAYER_ONE].men &&
+         a->players[PLAYER_ONE].kings == b->players[PLAYER_ONE].kings &&
+         a->players[PLAYER_TWO].men == b->players[PLAYER_TWO].men &&
+         a->players[PLAYER_TWO].kings == b->players[PLAYER_TWO].kings;
+}
+
+static inline bool is_empty_space(const GameState *game, Position board_idx) {
+  int sq = square_from_position(board_idx);
+  return sq != -1 && !(occupied_squares(game) & SQUARE_BIT(sq));
+}
+
+static inline bool contains_enemy(const GameState *game, int enemy_idx, Position pos) {
+  int sq = square_from_position(pos);
+  return sq != -1 && (player_pieces(&game->players[enemy_idx]) & SQUARE_BIT(sq));
+}
+
+#endif
@@ -0,0 +1,107 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "book.h"
+
+bool book_write(const char *path, const BookEntry *entries, size_t count, uint32_t min_games, uint32_t max_plies) {
+  // written next to the final name first so a reader never maps half a book
+  char tmp_path[512];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f) {
+    return false;
+  }
+  BookHeader header = {
+    .magic = BOOK_MAGIC,
+    .version = BOOK_VERSION,
+    .entry_count = count,
+    .min_games = min_games,
+    .max_plies = max_plies,
+  };
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            (count == 0 || fwrite(entries, sizeof(BookEntry), count, f) == count);
+  ok = (fclose(f) == 0) && ok;
+  return ok && rename(tmp_path, path) == 0;
+}
+
+bool book_open(Book *book, const char *path) {
+  memset(book, 0, sizeof(*book));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+    close(fd);
+    return false;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  const BookHeader *header = map;
+  if (header->magic != BOOK_MAGIC || header->version != BOOK_VERSION ||
+      header->entry_count > (st.st_size - sizeof(BookHeader)) / sizeof(BookEntry)) {
+    fprintf(stderr, "%s is not a valid opening book\n", path);
+    munmap(map, st.st_size);
+    return false;
+  }
+  book->header = header;
+  book->entries = (const BookEntry *)(header + 1);
+  book->map_length = st.st_size;
+  return true;
+}
+
+void book_close(Book *book) {
+  if (book->header) {
+    munmap((void *)book->header, book->map_length);
+  }
+  memset(book, 0, sizeof(*book));
+}
+
+int book_probe(const Book *book, const GameState *game, BookMove *moves, int max_moves) {
+  if (!book->header) {
+    return 0;
+  }
+  // first entry of the position, the entries of one position are adjacent
+  size_t low = 0;
+  size_t high = book->header->entry_count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (book->entries[mid].hash < game->hash) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  MoveList legal;
+  generate_moves(game, &legal);
+  int count = 0;
+  for (size_t i = low; i < book->header->entry_count && book->entries[i].hash == game->hash; i++) {
+    const BookEntry *e = &book->entries[i];
+    // a hash collision or a book from another move generator
+    if (e->move >= legal.count || count == max_moves) {
+      continue;
+    }
+    BookMove m = {
+      .move = legal.moves[e->move],
+      .games = book_entry_games(e),
+      .score = (e->wins + e->draws * 0.5) / book_entry_games(e),
+    };
+    // insertion sort, a position has only a handful of book moves
+    int j = count++;
+    while (j > 0 && (moves[j - 1].score < m.score ||
+                     (moves[j - 1].score == m.score && moves[j - 1].games < m.games))) {
+      moves[j] = moves[j - 1];
+      j--;
+    }
+    moves[j] = m;
+  }
+  return count;
+}
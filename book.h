@@ -0,0 +1,66 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+#include "moves.h"
+
+#define BOOK_MAGIC 0x4B424B43 // "CKBK"
+#define BOOK_VERSION 1
+// moves a game adds to the book, later ones are left to the search
+#define BOOK_DEFAULT_PLIES 24
+// a move played fewer times than this is not worth trusting
+#define BOOK_DEFAULT_MIN_GAMES 4
+// enough for every legal move of a position
+#define BOOK_MAX_MOVES MAX_MOVES
+
+// a book file is this header followed by entry_count entries sorted by
+// position hash and then move, in the machine's byte order so the
+// entries are searched in place
+typedef struct BookHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t entry_count;
+  uint32_t min_games;
+  uint32_t max_plies;
+} BookHeader;
+
+// how one move from one position did, counted for the side that played it
+typedef struct BookEntry {
+  uint64_t hash;
+  uint32_t wins;
+  uint32_t draws;
+  uint32_t losses;
+  // index of the move in generate_moves order
+  uint8_t move;
+  uint8_t padding[3];
+} BookEntry;
+
+typedef struct Book {
+  const BookHeader *header;
+  const BookEntry *entries;
+  size_t map_length;
+} Book;
+
+// a book move resolved against the position it is played in
+typedef struct BookMove {
+  Move move;
+  uint32_t games;
+  // expected result for the side to move, 1 is a certain win
+  double score;
+} BookMove;
+
+static inline uint32_t book_entry_games(const BookEntry *e) {
+  return e->wins + e->draws + e->losses;
+}
+
+// writes entries, which must be sorted and merged, to path
+bool book_write(const char *path, const BookEntry *entries, size_t count, uint32_t min_games, uint32_t max_plies);
+
+bool book_open(Book *book, const char *path);
+void book_close(Book *book);
+// the book moves of game, best score first, returns how many there are
+int book_probe(const Book *book, const GameState *game, BookMove *moves, int max_moves);
+
+#endif
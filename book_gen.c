@@ -0,0 +1,200 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+#include "record.h"
+#include "pdn.h"
+#include "book.h"
+#include "timeman.h"
+
+#define DEFAULT_BOOK "book.ckb"
+
+// every opening move seen so far, one entry per move played
+typedef struct BookBuilder {
+  BookEntry *entries;
+  size_t count;
+  size_t capacity;
+  int max_plies;
+  // the opening of the PDN game being read, added once its result is known
+  BookEntry pending[MAX_GAME_PLIES];
+  int pending_players[MAX_GAME_PLIES];
+  int pending_count;
+  GameState before;
+  uint64_t games;
+} BookBuilder;
+
+static bool has_suffix(const char *s, const char *suffix) {
+  size_t length = strlen(s);
+  size_t suffix_length = strlen(suffix);
+  return length >= suffix_length && strcmp(s + length - suffix_length, suffix) == 0;
+}
+
+static void add_move(BookBuilder *b, uint64_t hash, int move, int player, GameResult result) {
+  if (b->count == b->capacity) {
+    b->capacity = b->capacity ? b->capacity * 2 : 1 << 20;
+    b->entries = realloc(b->entries, b->capacity * sizeof(BookEntry));
+  }
+  BookEntry e = {.hash = hash, .move = move};
+  GameResult win = player == PLAYER_ONE ? GAME_PLAYER_ONE_WINS : GAME_PLAYER_TWO_WINS;
+  if (result == GAME_DRAW) {
+    e.draws = 1;
+  } else if (result == win) {
+    e.wins = 1;
+  } else {
+    e.losses = 1;
+  }
+  b->entries[b->count++] = e;
+}
+
+static bool add_record_file(BookBuilder *b, const char *path) {
+  RecordReader r;
+  if (!record_reader_open(&r, path)) {
+    return false;
+  }
+  RecordGame game;
+  while (record_next_game(&r, &game)) {
+    // unfinished games say nothing about their openings
+    if (game.result == GAME_ONGOING) {
+      continue;
+    }
+    GameState before = game.start;
+    Move m;
+    for (int ply = 0; ply < b->max_plies && record_next_move(&r, &m); ply++) {
+      add_move(b, before.hash, r.move_index, before.current_player, game.result);
+      before = *record_position(&r);
+    }
+    b->games++;
+  }
+  bool ok = !r.corrupt;
+  record_reader_close(&r);
+  return ok;
+}
+
+static void on_pdn_move(void *user, const PdnGame *game, int ply, const Move *m, const GameState *position) {
+  BookBuilder *b = user;
+  if (ply == 0) {
+    b->before = game->start;
+    b->pending_count = 0;
+  }
+  if (ply < b->max_plies) {
+    MoveList moves;
+    generate_moves(&b->before, &moves);
+    int index = 0;
+    while (index < moves.count && !(moves.moves[index].from == m->from && moves.moves[index].to == m->to &&
+                                    moves.moves[index].captured == m->captured)) {
+      index++;
+    }
+    b->pending[b->pending_count] = (BookEntry){.hash = b->before.hash, .move = index};
+    b->pending_players[b->pending_count++] = b->before.current_player;
+  }
+  b->before = *position;
+}
+
+static void on_pdn_game(void *user, const PdnGame *game) {
+  BookBuilder *b = user;
+  if (game->valid && game->result != GAME_ONGOING && game->ply_count > 0) {
+    for (int i = 0; i < b->pending_count; i++) {
+      add_move(b, b->pending[i].hash, b->pending[i].move, b->pending_players[i], game->result);
+    }
+    b->games++;
+  }
+  b->pending_count = 0;
+}
+
+static int compare_entries(const void *a, const void *b) {
+  const BookEntry *x = a;
+  const BookEntry *y = b;
+  if (x->hash != y->hash) {
+    return x->hash < y->hash ? -1 : 1;
+  }
+  return (int)x->move - (int)y->move;
+}
+
+// sorts the entries and sums up each move, dropping the rarely played
+static size_t merge_entries(BookEntry *entries, size_t count, uint32_t min_games) {
+  qsort(entries, count, sizeof(BookEntry), compare_entries);
+  size_t kept = 0;
+  for (size_t i = 0; i < count;) {
+    BookEntry sum = entries[i];
+    size_t j = i + 1;
+    for (; j < count && entries[j].hash == sum.hash && entries[j].move == sum.move; j++) {
+      sum.wins += entries[j].wins;
+      sum.draws += entries[j].draws;
+      sum.losses += entries[j].losses;
+    }
+    if (book_entry_games(&sum) >= min_games) {
+      entries[kept++] = sum;
+    }
+    i = j;
+  }
+  return kept;
+}
+
+static void print_book_moves(const Book *book, const GameState *position) {
+  BookMove moves[BOOK_MAX_MOVES];
+  int count = book_probe(book, position, moves, BOOK_MAX_MOVES);
+  for (int i = 0; i < count; i++) {
+    char notation[64];
+    format_move(&moves[i].move, notation, sizeof(notation));
+    printf("  %-8s %8u games, score %.3f\n", notation, moves[i].games, moves[i].score);
+  }
+}
+
+// book_gen [--book file] [--plies N] [--min-games N] games.ckr|games.pdn...
+// builds an opening book from finished games in record or PDN files
+int main(int argc, char **argv) {
+  const char *book_path = DEFAULT_BOOK;
+  uint32_t min_games = BOOK_DEFAULT_MIN_GAMES;
+  static BookBuilder b = {.max_plies = BOOK_DEFAULT_PLIES};
+  // every option applies to every file, wherever it stands on the line
+  const char **inputs = malloc(argc * sizeof(char *));
+  int input_count = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--book") == 0 && i + 1 < argc) {
+      book_path = argv[++i];
+    } else if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc) {
+      b.max_plies = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--min-games") == 0 && i + 1 < argc) {
+      min_games = strtoul(argv[++i], NULL, 10);
+    } else {
+      inputs[input_count++] = argv[i];
+    }
+  }
+  if (input_count == 0 || b.max_plies < 1 || b.max_plies > MAX_GAME_PLIES || min_games < 1) {
+    fprintf(stderr, "usage: %s [--book file] [--plies N] [--min-games N] games.ckr|games.pdn...\n", argv[0]);
+    return 2;
+  }
+  double start = now_seconds();
+  for (int i = 0; i < input_count; i++) {
+    PdnHandlers handlers = {.on_move = on_pdn_move, .on_game = on_pdn_game, .user = &b};
+    PdnStats stats = {0};
+    bool ok = has_suffix(inputs[i], ".pdn") ? pdn_parse_file(inputs[i], 1, &handlers, &stats)
+                                            : add_record_file(&b, inputs[i]);
+    if (!ok) {
+      fprintf(stderr, "could not read %s\n", inputs[i]);
+      return 1;
+    }
+  }
+  free(inputs);
+  size_t moves_seen = b.count;
+  size_t kept = merge_entries(b.entries, b.count, min_games);
+  if (!book_write(book_path, b.entries, kept, min_games, b.max_plies)) {
+    fprintf(stderr, "could not write %s\n", book_path);
+    return 1;
+  }
+  printf("%llu games, %zu opening moves, %zu book entries played at least %u times, %.2f s\n",
+         (unsigned long long)b.games, moves_seen, kept, min_games, now_seconds() - start);
+  Book book;
+  if (book_open(&book, book_path)) {
+    GameState initial;
+    game_init(&initial);
+    printf("from the start position:\n");
+    print_book_moves(&book, &initial);
+    book_close(&book);
+  }
+  free(b.entries);
+  return 0;
+}
@@ -1,6 +1,39 @@
-gcc -Wall -Werror -std=c99 \
+# rules core without any windowing dependency, shared by every program
+gcc -Wall -Werror -std=c99 -O2 -c board.c moves.c zobrist.c rules.c protocol.c net.c record.c pdn.c timeman.c &&
+ar rcs libcheckers.a board.o moves.o zobrist.o rules.o protocol.o net.o record.o pdn.o timeman.o &&
+gcc -Wall -Werror -std=c99 -O2 \
+  -o perft perft.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
+  -o bench bench.c search.c eval.c nnue.c tt.c egdb.c libcheckers.a -lm &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
+  -o eval_bench eval_bench.c eval.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
+  -o nnue_bench nnue_bench.c nnue.c eval.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
+  -o egdb_gen egdb_gen.c egdb.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 \
+  -o egdb_probe egdb_probe.c egdb.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
+  -o server server.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 \
+  -o loadgen loadgen.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 \
+  -o record_bench record_bench.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
+  -o pdn_bench pdn_bench.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 \
+  -o posindex_build posindex_build.c posindex.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 \
+  -o posindex_query posindex_query.c posindex.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 \
+  -o book_gen book_gen.c book.c libcheckers.a &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
+  -o selfplay selfplay.c search.c eval.c nnue.c tt.c egdb.c book.c libcheckers.a -lm &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
+  -o timeman_check timeman_check.c search.c eval.c nnue.c tt.c egdb.c libcheckers.a -lm &&
+gcc -Wall -Werror -std=c99 -O2 -pthread \
   -I/Users/macbookx/Coding/checkers/third-party/raylib/build/raylib/include \
-  -o main main.c \
+  -o main main.c search.c eval.c nnue.c tt.c egdb.c book.c libcheckers.a -lm \
   -L/Users/macbookx/Coding/checkers/third-party/raylib/build/raylib \
   -lraylib \
   -framework CoreVideo \
@@ -0,0 +1,461 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "egdb.h"
+#include "zobrist.h"
+
+#define MAX_PATH 512
+// a run this long or longer is stored as one repeated byte
+#define MIN_RUN 3
+#define MAX_RUN (0x7F + MIN_RUN)
+#define MAX_LITERAL 0x80
+#define RUN_FLAG 0x80
+
+// one mapped compressed slice file
+typedef struct EgdbTable {
+  const uint64_t *offsets;
+  const uint8_t *blocks;
+  uint64_t position_count;
+  uint32_t block_count;
+  void *map;
+  size_t map_length;
+} EgdbTable;
+
+typedef struct EgdbCacheEntry {
+  const EgdbTable *table;
+  // tables of an earlier egdb_open may share an address with new ones
+  uint32_t open_count;
+  uint32_t block;
+  uint64_t last_used;
+  uint8_t values[EGDB_BLOCK_BYTES];
+} EgdbCacheEntry;
+
+static uint64_t binomial[SQUARE_COUNT + 1][EGDB_MAX_PIECES + 1];
+static bool egdb_ready = false;
+
+static EgdbTable *tables[EGDB_MAX_PIECES + 1][EGDB_MAX_PIECES + 1][EGDB_MAX_PIECES + 1][EGDB_MAX_PIECES + 1];
+static int complete_pieces = 0;
+static uint32_t open_count = 0;
+
+static __thread EgdbCacheEntry block_cache[EGDB_CACHE_BLOCKS];
+static __thread uint64_t cache_clock = 0;
+
+void egdb_init(void) {
+  if (egdb_ready) {
+    return;
+  }
+  for (int n = 0; n <= SQUARE_COUNT; n++) {
+    binomial[n][0] = 1;
+    for (int k = 1; k <= EGDB_MAX_PIECES; k++) {
+      binomial[n][k] = (n == 0) ? 0 : binomial[n - 1][k - 1] + binomial[n - 1][k];
+    }
+  }
+  zobrist_init();
+  egdb_ready = true;
+}
+
+// squares a player's men may stand on, mapped to 0..EGDB_MAN_SQUARES-1
+static inline int man_square_base(int player_idx) {
+  return (player_idx == PLAYER_ONE) ? 0 : 4;
+}
+
+// combinatorial number system rank of the set bits of b, each square
+// shifted down by base
+static uint64_t rank_squares(Bitboard b, int base) {
+  uint64_t rank = 0;
+  int i = 1;
+  while (b) {
+    rank += binomial[__builtin_ctz(b) - base][i++];
+    b &= b - 1;
+  }
+  return rank;
+}
+
+static Bitboard unrank_squares(uint64_t rank, int count, int base) {
+  Bitboard b = EMPTY_BOARD;
+  int s = SQUARE_COUNT;
+  for (int i = count; i > 0; i--) {
+    do {
+      s--;
+    } while (binomial[s][i] > rank);
+    rank -= binomial[s][i];
+    b |= SQUARE_BIT(s + base);
+  }
+  return b;
+}
+
+// kings are ranked among the free squares only, so the number of
+// choices does not depend on where the men stand
+static Bitboard compress(Bitboard b, Bitboard free) {
+  Bitboard out = EMPTY_BOARD;
+  while (b) {
+    Bitboard lowest = b & -b;
+    out |= SQUARE_BIT(__builtin_popcount(free & (lowest - 1)));
+    b &= b - 1;
+  }
+  return out;
+}
+
+static Bitboard expand(Bitboard compressed, Bitboard free) {
+  Bitboard out = EMPTY_BOARD;
+  int i = 0;
+  while (free) {
+    Bitboard lowest = free & -free;
+    if (compressed & SQUARE_BIT(i)) {
+      out |= lowest;
+    }
+    free &= free - 1;
+    i++;
+  }
+  return out;
+}
+
+void egdb_slice_of(const GameState *game, EgdbSlice *slice) {
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    slice->men[i] = __builtin_popcount(game->players[i].men);
+    slice->kings[i] = __builtin_popcount(game->players[i].kings);
+  }
+}
+
+// choices for each index digit, outermost first
+static void slice_radix(const EgdbSlice *slice, uint64_t radix[4]) {
+  int men = slice->men[PLAYER_ONE] + slice->men[PLAYER_TWO];
+  radix[0] = binomial[EGDB_MAN_SQUARES][slice->men[PLAYER_ONE]];
+  radix[1] = binomial[EGDB_MAN_SQUARES][slice->men[PLAYER_TWO]];
+  radix[2] = binomial[SQUARE_COUNT - men][slice->kings[PLAYER_ONE]];
+  radix[3] = binomial[SQUARE_COUNT - men - slice->kings[PLAYER_ONE]][slice->kings[PLAYER_TWO]];
+}
+
+uint64_t egdb_slice_size(const EgdbSlice *slice) {
+  uint64_t radix[4];
+  slice_radix(slice, radix);
+  return radix[0] * radix[1] * radix[2] * radix[3] * PLAYER_COUNT;
+}
+
+uint64_t egdb_index(const GameState *game) {
+  EgdbSlice slice;
+  egdb_slice_of(game, &slice);
+  uint64_t radix[4];
+  slice_radix(&slice, radix);
+  const Player *one = &game->players[PLAYER_ONE];
+  const Player *two = &game->players[PLAYER_TWO];
+  Bitboard free_for_kings = ~(one->men | two->men);
+  uint64_t index = rank_squares(one->men, man_square_base(PLAYER_ONE));
+  index = index * radix[1] + rank_squares(two->men, man_square_base(PLAYER_TWO));
+  index = index * radix[2] + rank_squares(compress(one->kings, free_for_kings), 0);
+  free_for_kings &= ~one->kings;
+  index = index * radix[3] + rank_squares(compress(two->kings, free_for_kings), 0);
+  return index * PLAYER_COUNT + game->current_player;
+}
+
+bool egdb_position(const EgdbSlice *slice, uint64_t index, GameState *game) {
+  uint64_t radix[4];
+  slice_radix(slice, radix);
+  game->current_player = index % PLAYER_COUNT;
+  index /= PLAYER_COUNT;
+  uint64_t digits[4];
+  for (int i = 3; i >= 0; i--) {
+    digits[i] = index % radix[i];
+    index /= radix[i];
+  }
+  Player *one = &game->players[PLAYER_ONE];
+  Player *two = &game->players[PLAYER_TWO];
+  one->men = unrank_squares(digits[0], slice->men[PLAYER_ONE], man_square_base(PLAYER_ONE));
+  two->men = unrank_squares(digits[1], slice->men[PLAYER_TWO], man_square_base(PLAYER_TWO));
+  if (one->men & two->men) {
+    return false;
+  }
+  Bitboard free_for_kings = ~(one->men | two->men);
+  one->kings = expand(unrank_squares(digits[2], slice->kings[PLAYER_ONE], 0), free_for_kings);
+  free_for_kings &= ~one->kings;
+  two->kings = expand(unrank_squares(digits[3], slice->kings[PLAYER_TWO], 0), free_for_kings);
+  one->selected_piece = two->selected_piece = -1;
+  one->is_computer = two->is_computer = false;
+  game->is_game_over = false;
+  game->hash = compute_hash(game);
+  return true;
+}
+
+void egdb_slice_path(const char *dir, const EgdbSlice *slice, const char *ext,
+                     char *buf, size_t size) {
+  snprintf(buf, size, "%s/slice_%d%d%d%d.%s", dir,
+           slice->men[PLAYER_ONE], slice->kings[PLAYER_ONE],
+           slice->men[PLAYER_TWO], slice->kings[PLAYER_TWO], ext);
+}
+
+// byte oriented run length coding of the packed values, runs of equal
+// bytes are common since whole regions of a slice share one value
+// a token below RUN_FLAG is followed by token + 1 literal bytes,
+// otherwise the next byte repeats token - RUN_FLAG + MIN_RUN times
+static size_t compress_block(const uint8_t *in, size_t length, uint8_t *out) {
+  size_t written = 0;
+  size_t i = 0;
+  size_t literal_start = 0;
+  while (i <= length) {
+    size_t run = 1;
+    while (i + run < length && in[i + run] == in[i] && run < MAX_RUN) {
+      run++;
+    }
+    bool flush = (i == length) || run >= MIN_RUN || i - literal_start == MAX_LITERAL;
+    if (flush && i > literal_start) {
+      size_t literal = i - literal_start;
+      out[written++] = literal - 1;
+      memcpy(&out[written], &in[literal_start], literal);
+      written += literal;
+      literal_start = i;
+    }
+    if (i == length) {
+      break;
+    }
+    if (run >= MIN_RUN) {
+      out[written++] = RUN_FLAG | (run - MIN_RUN);
+      out[written++] = in[i];
+      i += run;
+      literal_start = i;
+    } else {
+      i++;
+    }
+  }
+  return written;
+}
+
+static bool decompress_block(const uint8_t *in, size_t in_length, uint8_t *out, size_t out_length) {
+  size_t read = 0;
+  size_t written = 0;
+  while (read < in_length) {
+    uint8_t token = in[read++];
+    if (token & RUN_FLAG) {
+      size_t run = (token & ~RUN_FLAG) + MIN_RUN;
+      if (read >= in_length || written + run > out_length) {
+        return false;
+      }
+      memset(&out[written], in[read++], run);
+      written += run;
+    } else {
+      size_t literal = token + 1;
+      if (read + literal > in_length || written + literal > out_length) {
+        return false;
+      }
+      memcpy(&out[written], &in[read], literal);
+      read += literal;
+      written += literal;
+    }
+  }
+  return written == out_length;
+}
+
+static uint32_t block_count_of(uint64_t position_count) {
+  return (position_count + EGDB_BLOCK_POSITIONS - 1) / EGDB_BLOCK_POSITIONS;
+}
+
+// bytes of packed values in block, only the last block is short
+static size_t block_bytes(uint64_t position_count, uint32_t block) {
+  uint64_t first = (uint64_t)block * EGDB_BLOCK_POSITIONS;
+  uint64_t positions = position_count - first < EGDB_BLOCK_POSITIONS ? position_count - first : EGDB_BLOCK_POSITIONS;
+  return (positions + 3) / 4;
+}
+
+bool egdb_write_compressed(const char *path, const EgdbSlice *slice, const uint8_t *values) {
+  char tmp_path[MAX_PATH + 4];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f) {
+    return false;
+  }
+  EgdbCompressedHeader header = {
+    .magic = EGDB_COMPRESSED_MAGIC,
+    .version = EGDB_VERSION,
+    .position_count = egdb_slice_size(slice),
+    .block_positions = EGDB_BLOCK_POSITIONS,
+  };
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    header.men[i] = slice->men[i];
+    header.kings[i] = slice->kings[i];
+  }
+  header.block_count = block_count_of(header.position_count);
+  uint64_t *offsets = calloc(header.block_count + 1, sizeof(uint64_t));
+  // worst case every byte is a literal, one token per MAX_LITERAL bytes
+  uint8_t compressed[EGDB_BLOCK_BYTES + EGDB_BLOCK_BYTES / MAX_LITERAL + 1];
+  // offsets are only known once every block is written, so their space
+  // is skipped first and filled in at the end
+  bool ok = offsets &&
+            fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(offsets, sizeof(uint64_t), header.block_count + 1, f) == header.block_count + 1;
+  for (uint32_t b = 0; ok && b < header.block_count; b++) {
+    size_t length = compress_block(&values[(uint64_t)b * EGDB_BLOCK_BYTES],
+                                   block_bytes(header.position_count, b), compressed);
+    ok = fwrite(compressed, 1, length, f) == length;
+    offsets[b + 1] = offsets[b] + length;
+  }
+  ok = ok && fseek(f, sizeof(header), SEEK_SET) == 0 &&
+       fwrite(offsets, sizeof(uint64_t), header.block_count + 1, f) == header.block_count + 1;
+  ok = (fclose(f) == 0) && ok;
+  free(offsets);
+  return ok && rename(tmp_path, path) == 0;
+}
+
+// block b spans offsets[b] to offsets[b + 1], so the offsets must start at
+// zero and never go back for every block length to be meaningful
+static bool offsets_ordered(const uint64_t *offsets, uint32_t block_count) {
+  if (offsets[0] != 0) {
+    return false;
+  }
+  for (uint32_t b = 0; b < block_count; b++) {
+    if (offsets[b + 1] < offsets[b]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static EgdbTable *open_table(const char *path, const EgdbSlice *slice) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(EgdbCompressedHeader)) {
+    close(fd);
+    return NULL;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+  const EgdbCompressedHeader *header = map;
+  uint64_t size = egdb_slice_size(slice);
+  size_t offsets_end = sizeof(EgdbCompressedHeader) + (header->block_count + 1) * sizeof(uint64_t);
+  const uint64_t *offsets = (const uint64_t *)(header + 1);
+  if (header->magic != EGDB_COMPRESSED_MAGIC || header->version != EGDB_VERSION ||
+      header->position_count != size || header->block_positions != EGDB_BLOCK_POSITIONS ||
+      header->block_count != block_count_of(size) || (size_t)st.st_size < offsets_end ||
+      (size_t)st.st_size - offsets_end < offsets[header->block_count] ||
+      !offsets_ordered(offsets, header->block_count)) {
+    fprintf(stderr, "%s is not a valid compressed slice file\n", path);
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  // probes touch blocks all over the file, read ahead only wastes cache
+  posix_madvise(map, st.st_size, POSIX_MADV_RANDOM);
+  EgdbTable *t = malloc(sizeof(EgdbTable));
+  t->offsets = offsets;
+  t->blocks = (const uint8_t *)map + offsets_end;
+  t->position_count = size;
+  t->block_count = header->block_count;
+  t->map = map;
+  t->map_length = st.st_size;
+  return t;
+}
+
+int egdb_open(const char *dir) {
+  egdb_init();
+  egdb_close();
+  open_count++;
+  int found = 0;
+  bool complete = true;
+  for (int pieces = 2; pieces <= EGDB_MAX_PIECES; pieces++) {
+    for (int m1 = 0; m1 <= pieces; m1++) {
+      for (int k1 = 0; m1 + k1 <= pieces; k1++) {
+        for (int m2 = 0; m1 + k1 + m2 <= pieces; m2++) {
+          EgdbSlice slice = {
+            .men = {m1, m2},
+            .kings = {k1, pieces - m1 - k1 - m2},
+          };
+          if (m1 + k1 == 0 || pieces - m1 - k1 == 0) {
+            continue;
+          }
+          char path[MAX_PATH];
+          egdb_slice_path(dir, &slice, "cdb", path, sizeof(path));
+          EgdbTable *t = open_table(path, &slice);
+          tables[m1][k1][m2][slice.kings[PLAYER_TWO]] = t;
+          if (t) {
+            found++;
+          } else {
+            complete = false;
+          }
+        }
+      }
+    }
+    if (complete) {
+      complete_pieces = pieces;
+    }
+  }
+  return found;
+}
+
+void egdb_close(void) {
+  for (int m1 = 0; m1 <= EGDB_MAX_PIECES; m1++) {
+    for (int k1 = 0; k1 <= EGDB_MAX_PIECES; k1++) {
+      for (int m2 = 0; m2 <= EGDB_MAX_PIECES; m2++) {
+        for (int k2 = 0; k2 <= EGDB_MAX_PIECES; k2++) {
+          EgdbTable *t = tables[m1][k1][m2][k2];
+          if (t) {
+            munmap(t->map, t->map_length);
+            free(t);
+            tables[m1][k1][m2][k2] = NULL;
+          }
+        }
+      }
+    }
+  }
+  complete_pieces = 0;
+}
+
+int egdb_max_pieces(void) {
+  return complete_pieces;
+}
+
+// decompressed values of block, from this thread's cache when possible
+static const uint8_t *cached_block(const EgdbTable *t, uint32_t block) {
+  EgdbCacheEntry *victim = &block_cache[0];
+  cache_clock++;
+  for (int i = 0; i < EGDB_CACHE_BLOCKS; i++) {
+    EgdbCacheEntry *e = &block_cache[i];
+    if (e->table == t && e->block == block && e->open_count == open_count) {
+      e->last_used = cache_clock;
+      return e->values;
+    }
+    if (e->last_used < victim->last_used) {
+      victim = e;
+    }
+  }
+  if (!decompress_block(&t->blocks[t->offsets[block]], t->offsets[block + 1] - t->offsets[block],
+                        victim->values, block_bytes(t->position_count, block))) {
+    victim->table = NULL;
+    return NULL;
+  }
+  victim->table = t;
+  victim->open_count = open_count;
+  victim->block = block;
+  victim->last_used = cache_clock;
+  return victim->values;
+}
+
+EgdbValue egdb_probe(const GameState *game) {
+  // a side without pieces has no moves and has lost
+  if (!player_pieces(&game->players[game->current_player])) {
+    return EGDB_LOSS;
+  }
+  EgdbSlice slice;
+  egdb_slice_of(game, &slice);
+  if (egdb_slice_pieces(&slice) > EGDB_MAX_PIECES) {
+    return EGDB_UNKNOWN;
+  }
+  const EgdbTable *t = tables[slice.men[PLAYER_ONE]][slice.kings[PLAYER_ONE]]
+                            [slice.men[PLAYER_TWO]][slice.kings[PLAYER_TWO]];
+  if (!t) {
+    return EGDB_UNKNOWN;
+  }
+  uint64_t index = egdb_index(game);
+  const uint8_t *values = cached_block(t, index / EGDB_BLOCK_POSITIONS);
+  if (!values) {
+    return EGDB_UNKNOWN;
+  }
+  return egdb_packed_value(values, index % EGDB_BLOCK_POSITIONS);
+}
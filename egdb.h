@@ -0,0 +1,93 @@
+#ifndef EGDB_H
+#define EGDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+
+#define EGDB_MAX_PIECES 8
+// men never stand on their own crowning row
+#define EGDB_MAN_SQUARES 28
+#define EGDB_MAGIC 0x42444B43 // "CKDB"
+#define EGDB_VERSION 1
+#define EGDB_COMPRESSED_MAGIC 0x5A444B43 // "CKDZ"
+// positions per compressed block, one block is decompressed per cache miss
+#define EGDB_BLOCK_POSITIONS 4096
+#define EGDB_BLOCK_BYTES (EGDB_BLOCK_POSITIONS / 4)
+// decompressed blocks each probing thread keeps
+#define EGDB_CACHE_BLOCKS 32
+
+// value for the side to move
+typedef enum EgdbValue {
+  EGDB_UNKNOWN,
+  EGDB_WIN,
+  EGDB_LOSS,
+  EGDB_DRAW,
+} EgdbValue;
+
+// a slice holds every position with the same piece counts,
+// both sides to move, indexed by player
+typedef struct EgdbSlice {
+  int men[PLAYER_COUNT];
+  int kings[PLAYER_COUNT];
+} EgdbSlice;
+
+// header of a raw slice file, followed by 2 bit values, 4 per byte,
+// in egdb_index order
+typedef struct EgdbFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t men[PLAYER_COUNT];
+  int32_t kings[PLAYER_COUNT];
+  uint64_t position_count;
+} EgdbFileHeader;
+
+// header of a compressed slice file, followed by block_count + 1 byte
+// offsets of the blocks relative to the end of the offsets, then the
+// run length encoded blocks of packed values
+typedef struct EgdbCompressedHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t men[PLAYER_COUNT];
+  int32_t kings[PLAYER_COUNT];
+  uint64_t position_count;
+  uint32_t block_positions;
+  uint32_t block_count;
+} EgdbCompressedHeader;
+
+// fills the binomial tables, must run once before any threads are started
+void egdb_init(void);
+
+static inline int egdb_slice_pieces(const EgdbSlice *slice) {
+  return slice->men[PLAYER_ONE] + slice->kings[PLAYER_ONE] +
+         slice->men[PLAYER_TWO] + slice->kings[PLAYER_TWO];
+}
+
+void egdb_slice_of(const GameState *game, EgdbSlice *slice);
+uint64_t egdb_slice_size(const EgdbSlice *slice);
+uint64_t egdb_index(const GameState *game);
+// rebuilds the position stored at index, false for indices where the
+// two players' men would share a square
+bool egdb_position(const EgdbSlice *slice, uint64_t index, GameState *game);
+void egdb_slice_path(const char *dir, const EgdbSlice *slice, const char *ext,
+                     char *buf, size_t size);
+
+// writes the packed values of a solved slice as a compressed slice file
+bool egdb_write_compressed(const char *path, const EgdbSlice *slice, const uint8_t *values);
+
+// maps every compressed slice file in dir read only, so all processes
+// probing the same files share one copy in the page cache
+// call before any thread probes, returns the number of slices found
+int egdb_open(const char *dir);
+void egdb_close(void);
+// largest piece count for which every slice is loaded, 0 without a database
+int egdb_max_pieces(void);
+// value of game for its side to move or EGDB_UNKNOWN when no loaded
+// slice holds it, safe to call from many threads at once
+EgdbValue egdb_probe(const GameState *game);
+
+static inline EgdbValue egdb_packed_value(const uint8_t *values, uint64_t index) {
+  return (EgdbValue)((values[index >> 2] >> ((index & 3) * 2)) & 3);
+}
+
+#endif
@@ -0,0 +1,470 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "board.h"
+#include "moves.h"
+#include "egdb.h"
+#include "timeman.h"
+
+#define DEFAULT_DIR "egdb"
+#define CHUNK_POSITIONS (1 << 14)
+// slices of one group share total pieces and total men, so a move
+// never leads from one of them into another
+#define MAX_GROUP_SLICES ((EGDB_MAX_PIECES + 1) * (EGDB_MAX_PIECES + 1))
+#define MAX_PATH 512
+
+// counter value of a position that has a drawn move leaving the slice
+#define CANNOT_LOSE 0xFF
+
+typedef struct SliceTable {
+  EgdbSlice slice;
+  uint64_t size;
+  // 2 bit values, 4 per byte
+  uint8_t *values;
+  // values point into a read only mapping of the slice file
+  void *map;
+  size_t map_length;
+  // only while the slice is being solved: moves into the slice not yet
+  // known to be won for the opponent, and bitmaps of the positions
+  // solved in the last pass and the current one
+  uint8_t *counters;
+  uint8_t *frontier;
+  uint8_t *next_frontier;
+} SliceTable;
+
+typedef struct Generator {
+  const char *dir;
+  int thread_count;
+  SliceTable *tables[EGDB_MAX_PIECES + 1][EGDB_MAX_PIECES + 1][EGDB_MAX_PIECES + 1][EGDB_MAX_PIECES + 1];
+  // slices being solved in the current group
+  SliceTable *group[MAX_GROUP_SLICES];
+  uint64_t group_chunks[MAX_GROUP_SLICES];
+  int group_count;
+  uint64_t chunk_total;
+  // what the current pass does to each chunk
+  void (*work)(struct Generator *g, SliceTable *t, uint64_t first, uint64_t last);
+  uint64_t next_chunk;
+  uint64_t changed;
+  uint64_t invalid;
+} Generator;
+
+typedef void (*ChunkWorker)(Generator *g, SliceTable *t, uint64_t first, uint64_t last);
+
+// men only move forward, kings move along every diagonal
+static const Diagonal forward_diagonals[PLAYER_COUNT][2] = {
+  [PLAYER_ONE] = {UP_LEFT, UP_RIGHT},
+  [PLAYER_TWO] = {DOWN_LEFT, DOWN_RIGHT},
+};
+
+SliceTable **table_slot(Generator *g, const EgdbSlice *s) {
+  return &g->tables[s->men[PLAYER_ONE]][s->kings[PLAYER_ONE]][s->men[PLAYER_TWO]][s->kings[PLAYER_TWO]];
+}
+
+bool load_slice(Generator *g, const EgdbSlice *slice) {
+  char path[MAX_PATH];
+  egdb_slice_path(g->dir, slice, "raw", path, sizeof(path));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(EgdbFileHeader)) {
+    close(fd);
+    return false;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  const EgdbFileHeader *header = map;
+  uint64_t size = egdb_slice_size(slice);
+  if (header->magic != EGDB_MAGIC || header->version != EGDB_VERSION ||
+      header->position_count != size ||
+      (size_t)st.st_size < sizeof(EgdbFileHeader) + (size + 3) / 4) {
+    fprintf(stderr, "%s is not a valid slice file\n", path);
+    munmap(map, st.st_size);
+    return false;
+  }
+  SliceTable *t = calloc(1, sizeof(SliceTable));
+  t->slice = *slice;
+  t->size = size;
+  t->values = (uint8_t *)map + sizeof(EgdbFileHeader);
+  t->map = map;
+  t->map_length = st.st_size;
+  *table_slot(g, slice) = t;
+  return true;
+}
+
+// value of pos for its side to move, pos must be in a solved or current slice
+EgdbValue lookup(Generator *g, const GameState *pos) {
+  // a side without pieces has no moves and has lost
+  if (!player_pieces(&pos->players[pos->current_player])) {
+    return EGDB_LOSS;
+  }
+  EgdbSlice slice;
+  egdb_slice_of(pos, &slice);
+  SliceTable *t = *table_slot(g, &slice);
+  if (!t) {
+    fprintf(stderr, "missing dependency slice %d%d%d%d\n",
+            slice.men[PLAYER_ONE], slice.kings[PLAYER_ONE],
+            slice.men[PLAYER_TWO], slice.kings[PLAYER_TWO]);
+    exit(1);
+  }
+  uint64_t index = egdb_index(pos);
+  uint8_t byte = __atomic_load_n(&t->values[index >> 2], __ATOMIC_RELAXED);
+  return (EgdbValue)((byte >> ((index & 3) * 2)) & 3);
+}
+
+static inline void set_value(SliceTable *t, uint64_t index, EgdbValue v) {
+  __atomic_fetch_or(&t->values[index >> 2], v << ((index & 3) * 2), __ATOMIC_RELAXED);
+}
+
+static inline EgdbValue get_value(SliceTable *t, uint64_t index) {
+  return (EgdbValue)((__atomic_load_n(&t->values[index >> 2], __ATOMIC_RELAXED) >> ((index & 3) * 2)) & 3);
+}
+
+static inline void mark(uint8_t *bitmap, uint64_t index) {
+  __atomic_fetch_or(&bitmap[index >> 3], 1 << (index & 7), __ATOMIC_RELAXED);
+}
+
+// first pass over a slice: moves leaving the slice (captures and
+// crownings) lead to solved slices and are looked up, moves staying in
+// the slice are only counted and resolved later by propagation
+void init_chunk(Generator *g, SliceTable *t, uint64_t first, uint64_t last) {
+  uint64_t solved = 0;
+  uint64_t invalid = 0;
+  for (uint64_t index = first; index < last; index++) {
+    GameState pos;
+    if (!egdb_position(&t->slice, index, &pos)) {
+      // never probed, a draw keeps it out of the propagation
+      set_value(t, index, EGDB_DRAW);
+      t->counters[index] = CANNOT_LOSE;
+      invalid++;
+      continue;
+    }
+    MoveList moves;
+    int count = generate_moves(&pos, &moves);
+    int in_slice = 0;
+    bool can_lose = true;
+    bool won = false;
+    for (int i = 0; i < count && !won; i++) {
+      const Move *m = &moves.moves[i];
+      if (!is_capture(m) && !m->promotes) {
+        in_slice++;
+        continue;
+      }
+      make_move(&pos, m);
+      EgdbValue v = lookup(g, &pos);
+      unmake_move(&pos, m);
+      if (v == EGDB_LOSS) {
+        won = true;
+      } else if (v != EGDB_WIN) {
+        can_lose = false;
+      }
+    }
+    EgdbValue v = EGDB_UNKNOWN;
+    if (won) {
+      v = EGDB_WIN;
+    } else if (in_slice == 0) {
+      v = can_lose ? EGDB_LOSS : EGDB_DRAW;
+    }
+    t->counters[index] = can_lose ? in_slice : CANNOT_LOSE;
+    if (v != EGDB_UNKNOWN) {
+      set_value(t, index, v);
+      solved++;
+      if (v != EGDB_DRAW) {
+        mark(t->frontier, index);
+      }
+    }
+  }
+  __atomic_add_fetch(&g->changed, solved, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&g->invalid, invalid, __ATOMIC_RELAXED);
+}
+
+// pred is one quiet move before pos, credit it with the value of pos
+static void update_predecessor(SliceTable *t, const GameState *pred, EgdbValue pos_value, uint64_t *solved) {
+  // the move is only legal when pred had no capture to make instead
+  if (capturing_pieces(pred)) {
+    return;
+  }
+  uint64_t index = egdb_index(pred);
+  if (get_value(t, index) != EGDB_UNKNOWN) {
+    return;
+  }
+  EgdbValue v = EGDB_UNKNOWN;
+  if (pos_value == EGDB_LOSS) {
+    v = EGDB_WIN;
+  } else if (t->counters[index] != CANNOT_LOSE &&
+             __atomic_sub_fetch(&t->counters[index], 1, __ATOMIC_RELAXED) == 0) {
+    // every move from pred reaches a position won for the opponent
+    v = EGDB_LOSS;
+  }
+  if (v == EGDB_UNKNOWN) {
+    return;
+  }
+  // several solved successors may reach the same predecessor at once,
+  // only the thread that fills the empty value queues it
+  uint8_t old = __atomic_fetch_or(&t->values[index >> 2], v << ((index & 3) * 2), __ATOMIC_RELAXED);
+  if (((old >> ((index & 3) * 2)) & 3) == EGDB_UNKNOWN) {
+    mark(t->next_frontier, index);
+    (*solved)++;
+  }
+}
+
+// walks every quiet move backwards out of the positions solved in the
+// last pass, which is the retrograde step
+void propagate_chunk(Generator *g, SliceTable *t, uint64_t first, uint64_t last) {
+  uint64_t solved = 0;
+  for (uint64_t index = first; index < last; index++) {
+    if (!(t->frontier[index >> 3] & (1 << (index & 7)))) {
+      continue;
+    }
+    EgdbValue v = get_value(t, index);
+    GameState pos;
+    egdb_position(&t->slice, index, &pos);
+    // the player who just moved is the one not to move in pos
+    int mover = enemy_of(pos.current_player);
+    Bitboard empty = ~occupied_squares(&pos);
+    for (int d = 0; d < DIAGONAL_COUNT; d++) {
+      Diagonal back = opposite_diagonal(d);
+      bool men_move_along_d = forward_diagonals[mover][0] == (Diagonal)d ||
+                              forward_diagonals[mover][1] == (Diagonal)d;
+      // a piece that arrived along d came from one step back along it
+      for (int type = PAWN; type <= KING; type++) {
+        Bitboard pieces = (type == KING) ? pos.players[mover].kings : pos.players[mover].men;
+        if (type == PAWN && !men_move_along_d) {
+          continue;
+        }
+        Bitboard targets = pieces & shift_diagonal(empty, d);
+        while (targets) {
+          Bitboard to = targets & -targets;
+          targets &= targets - 1;
+          Bitboard from_to = to | shift_diagonal(to, back);
+          GameState pred = pos;
+          if (type == KING) {
+            pred.players[mover].kings ^= from_to;
+          } else {
+            pred.players[mover].men ^= from_to;
+          }
+          pred.current_player = mover;
+          update_predecessor(t, &pred, v, &solved);
+        }
+      }
+    }
+  }
+  __atomic_add_fetch(&g->changed, solved, __ATOMIC_RELAXED);
+}
+
+void *pass_worker(void *arg) {
+  Generator *g = arg;
+  for (;;) {
+    uint64_t chunk = __atomic_fetch_add(&g->next_chunk, 1, __ATOMIC_RELAXED);
+    if (chunk >= g->chunk_total) {
+      break;
+    }
+    int s = 0;
+    while (chunk >= g->group_chunks[s]) {
+      chunk -= g->group_chunks[s++];
+    }
+    SliceTable *t = g->group[s];
+    uint64_t first = chunk * CHUNK_POSITIONS;
+    uint64_t last = first + CHUNK_POSITIONS < t->size ? first + CHUNK_POSITIONS : t->size;
+    g->work(g, t, first, last);
+  }
+  return NULL;
+}
+
+// runs work over every chunk of the group on all threads and returns
+// how many positions got solved
+uint64_t run_pass(Generator *g, ChunkWorker work) {
+  g->work = work;
+  g->next_chunk = 0;
+  g->changed = 0;
+  pthread_t threads[g->thread_count];
+  int started = 0;
+  for (int i = 1; i < g->thread_count; i++) {
+    if (pthread_create(&threads[started], NULL, pass_worker, g) == 0) {
+      started++;
+    }
+  }
+  pass_worker(g);
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  return g->changed;
+}
+
+bool write_slice(Generator *g, SliceTable *t) {
+  char path[MAX_PATH];
+  char tmp_path[MAX_PATH + 4];
+  egdb_slice_path(g->dir, &t->slice, "raw", path, sizeof(path));
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f) {
+    return false;
+  }
+  EgdbFileHeader header = {
+    .magic = EGDB_MAGIC,
+    .version = EGDB_VERSION,
+    .position_count = t->size,
+  };
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    header.men[i] = t->slice.men[i];
+    header.kings[i] = t->slice.kings[i];
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(t->values, 1, (t->size + 3) / 4, f) == (t->size + 3) / 4;
+  ok = (fclose(f) == 0) && ok;
+  // a slice only appears under its real name once it is complete,
+  // so an interrupted run never leaves a truncated slice behind
+  return ok && rename(tmp_path, path) == 0;
+}
+
+// the raw file stays the generator's own input, probing uses the
+// compressed copy
+bool write_compressed(Generator *g, const SliceTable *t) {
+  char path[MAX_PATH];
+  egdb_slice_path(g->dir, &t->slice, "cdb", path, sizeof(path));
+  if (access(path, F_OK) == 0) {
+    return true;
+  }
+  return egdb_write_compressed(path, &t->slice, t->values);
+}
+
+void solve_group(Generator *g) {
+  double start = now_seconds();
+  g->chunk_total = 0;
+  g->invalid = 0;
+  for (int i = 0; i < g->group_count; i++) {
+    g->group_chunks[i] = (g->group[i]->size + CHUNK_POSITIONS - 1) / CHUNK_POSITIONS;
+    g->chunk_total += g->group_chunks[i];
+  }
+  run_pass(g, init_chunk);
+  int passes = 1;
+  // positions solved in one pass are propagated in the next, until a
+  // pass solves nothing new
+  for (;;) {
+    uint64_t solved = run_pass(g, propagate_chunk);
+    for (int i = 0; i < g->group_count; i++) {
+      SliceTable *t = g->group[i];
+      uint8_t *done = t->frontier;
+      t->frontier = t->next_frontier;
+      t->next_frontier = done;
+      memset(t->next_frontier, 0, (t->size + 7) / 8);
+    }
+    if (solved == 0) {
+      break;
+    }
+    passes++;
+  }
+  for (int i = 0; i < g->group_count; i++) {
+    SliceTable *t = g->group[i];
+    free(t->counters);
+    free(t->frontier);
+    free(t->next_frontier);
+    uint64_t counts[4] = {0};
+    for (uint64_t index = 0; index < t->size; index++) {
+      int shift = (index & 3) * 2;
+      EgdbValue v = (EgdbValue)((t->values[index >> 2] >> shift) & 3);
+      // whatever neither side can force is a draw
+      if (v == EGDB_UNKNOWN) {
+        v = EGDB_DRAW;
+        t->values[index >> 2] |= EGDB_DRAW << shift;
+      }
+      counts[v]++;
+    }
+    if (!write_slice(g, t)) {
+      fprintf(stderr, "could not write slice: %s\n", strerror(errno));
+      exit(1);
+    }
+    printf("slice %d%d%d%d: %llu positions, %llu wins, %llu losses, %llu draws\n",
+           t->slice.men[PLAYER_ONE], t->slice.kings[PLAYER_ONE],
+           t->slice.men[PLAYER_TWO], t->slice.kings[PLAYER_TWO],
+           (unsigned long long)t->size, (unsigned long long)counts[EGDB_WIN],
+           (unsigned long long)counts[EGDB_LOSS], (unsigned long long)counts[EGDB_DRAW]);
+    // solved slices are read back through the page cache instead of
+    // staying in memory, so memory use is bounded by the largest group
+    EgdbSlice slice = t->slice;
+    *table_slot(g, &slice) = NULL;
+    free(t->values);
+    free(t);
+    if (!load_slice(g, &slice) || !write_compressed(g, *table_slot(g, &slice))) {
+      fprintf(stderr, "could not reload or compress written slice\n");
+      exit(1);
+    }
+  }
+  printf("  %d passes, %llu unused indices, %.2f s\n", passes,
+         (unsigned long long)g->invalid, now_seconds() - start);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  int max_pieces = argc > 1 ? atoi(argv[1]) : 4;
+  const char *dir = argc > 2 ? argv[2] : DEFAULT_DIR;
+  int thread_count = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (max_pieces < 2 || max_pieces > EGDB_MAX_PIECES || thread_count < 1) {
+    fprintf(stderr, "usage: %s [max pieces 2-%d] [dir] [threads]\n", argv[0], EGDB_MAX_PIECES);
+    return 2;
+  }
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "could not create %s: %s\n", dir, strerror(errno));
+    return 1;
+  }
+  egdb_init();
+  static Generator g;
+  g.dir = dir;
+  g.thread_count = thread_count;
+
+  for (int pieces = 2; pieces <= max_pieces; pieces++) {
+    // promotions turn men into kings, so fewer men are solved first
+    for (int men = 0; men <= pieces; men++) {
+      g.group_count = 0;
+      for (int m1 = 0; m1 <= men; m1++) {
+        for (int k1 = 0; k1 <= pieces - men; k1++) {
+          EgdbSlice slice = {
+            .men = {m1, men - m1},
+            .kings = {k1, pieces - men - k1},
+          };
+          if (m1 + k1 == 0 || pieces - m1 - k1 == 0) {
+            continue;
+          }
+          // slices from earlier runs are reused as they are
+          if (*table_slot(&g, &slice)) {
+            continue;
+          }
+          if (load_slice(&g, &slice)) {
+            if (!write_compressed(&g, *table_slot(&g, &slice))) {
+              fprintf(stderr, "could not compress slice: %s\n", strerror(errno));
+              return 1;
+            }
+            continue;
+          }
+          SliceTable *t = calloc(1, sizeof(SliceTable));
+          t->slice = slice;
+          t->size = egdb_slice_size(&slice);
+          t->values = calloc((t->size + 3) / 4, 1);
+          t->counters = malloc(t->size);
+          t->frontier = calloc((t->size + 7) / 8, 1);
+          t->next_frontier = calloc((t->size + 7) / 8, 1);
+          if (!t->values || !t->counters || !t->frontier || !t->next_frontier) {
+            fprintf(stderr, "out of memory for slice of %llu positions\n", (unsigned long long)t->size);
+            return 1;
+          }
+          *table_slot(&g, &slice) = t;
+          g.group[g.group_count++] = t;
+        }
+      }
+      if (g.group_count > 0) {
+        solve_group(&g);
+      }
+    }
+  }
+  return 0;
+}
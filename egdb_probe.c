@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "board.h"
+#include "egdb.h"
+#include "timeman.h"
+
+#define DEFAULT_DIR "egdb"
+#define RANDOM_PROBES 1000000
+#define MAX_PATH 512
+
+static const char *value_names[] = {
+  [EGDB_UNKNOWN] = "unknown",
+  [EGDB_WIN] = "win",
+  [EGDB_LOSS] = "loss",
+  [EGDB_DRAW] = "draw",
+};
+
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+// packed values of a raw slice file written by egdb_gen, NULL without one
+static uint8_t *read_raw_slice(const char *dir, const EgdbSlice *slice, uint64_t size) {
+  char path[MAX_PATH];
+  egdb_slice_path(dir, slice, "raw", path, sizeof(path));
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return NULL;
+  }
+  EgdbFileHeader header;
+  uint8_t *values = malloc((size + 3) / 4);
+  if (!values || fread(&header, sizeof(header), 1, f) != 1 ||
+      header.position_count != size || fread(values, 1, (size + 3) / 4, f) != (size + 3) / 4) {
+    free(values);
+    values = NULL;
+  }
+  fclose(f);
+  return values;
+}
+
+// every slice of up to max_pieces pieces, in the order egdb_open loads them
+static int list_slices(int max_pieces, EgdbSlice *slices) {
+  int count = 0;
+  for (int pieces = 2; pieces <= max_pieces; pieces++) {
+    for (int m1 = 0; m1 <= pieces; m1++) {
+      for (int k1 = 0; m1 + k1 <= pieces; k1++) {
+        for (int m2 = 0; m1 + k1 + m2 <= pieces; m2++) {
+          EgdbSlice slice = {
+            .men = {m1, m2},
+            .kings = {k1, pieces - m1 - k1 - m2},
+          };
+          if (m1 + k1 > 0 && pieces - m1 - k1 > 0) {
+            slices[count++] = slice;
+          }
+        }
+      }
+    }
+  }
+  return count;
+}
+
+// probes every position of every slice in index order and compares it
+// with the raw files, which also times probes that hit the block cache
+static bool verify(const char *dir, const EgdbSlice *slices, int slice_count) {
+  uint64_t probes = 0;
+  double elapsed = 0;
+  int verified = 0;
+  for (int i = 0; i < slice_count; i++) {
+    uint64_t size = egdb_slice_size(&slices[i]);
+    uint8_t *raw = read_raw_slice(dir, &slices[i], size);
+    if (!raw) {
+      continue;
+    }
+    double start = now_seconds();
+    for (uint64_t index = 0; index < size; index++) {
+      GameState game;
+      if (!egdb_position(&slices[i], index, &game)) {
+        continue;
+      }
+      EgdbValue v = egdb_probe(&game);
+      if (v != egdb_packed_value(raw, index)) {
+        fprintf(stderr, "slice %d%d%d%d index %llu: probed %s, raw file has %s\n",
+                slices[i].men[PLAYER_ONE], slices[i].kings[PLAYER_ONE],
+                slices[i].men[PLAYER_TWO], slices[i].kings[PLAYER_TWO],
+                (unsigned long long)index, value_names[v], value_names[egdb_packed_value(raw, index)]);
+        free(raw);
+        return false;
+      }
+      probes++;
+    }
+    elapsed += now_seconds() - start;
+    verified++;
+    free(raw);
+  }
+  if (verified > 0) {
+    printf("verified %d slices against raw files, %llu sequential probes, %.0f ns per probe\n",
+           verified, (unsigned long long)probes, elapsed / probes * 1e9);
+  }
+  return true;
+}
+
+// probes scattered over all slices, so most of them decompress a block
+static void time_random_probes(const EgdbSlice *slices, int slice_count) {
+  GameState *positions = malloc(RANDOM_PROBES * sizeof(GameState));
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (int i = 0; i < RANDOM_PROBES;) {
+    const EgdbSlice *slice = &slices[next_random(&state) % slice_count];
+    if (egdb_position(slice, next_random(&state) % egdb_slice_size(slice), &positions[i])) {
+      i++;
+    }
+  }
+  uint64_t counts[4] = {0};
+  double start = now_seconds();
+  for (int i = 0; i < RANDOM_PROBES; i++) {
+    counts[egdb_probe(&positions[i])]++;
+  }
+  double elapsed = now_seconds() - start;
+  printf("%d random probes, %.0f ns per probe, %llu wins %llu losses %llu draws %llu unknown\n",
+         RANDOM_PROBES, elapsed / RANDOM_PROBES * 1e9,
+         (unsigned long long)counts[EGDB_WIN], (unsigned long long)counts[EGDB_LOSS],
+         (unsigned long long)counts[EGDB_DRAW], (unsigned long long)counts[EGDB_UNKNOWN]);
+  free(positions);
+}
+
+int main(int argc, char **argv) {
+  const char *dir = argc > 1 ? argv[1] : DEFAULT_DIR;
+  int found = egdb_open(dir);
+  if (found == 0 || egdb_max_pieces() == 0) {
+    fprintf(stderr, "no complete database in %s\nusage: %s [dir] [fen]\n", dir, argv[0]);
+    return 1;
+  }
+  printf("%d slices, complete up to %d pieces\n", found, egdb_max_pieces());
+  if (argc > 2) {
+    GameState game;
+    game_init(&game);
+    if (!game_set_fen(&game, argv[2])) {
+      fprintf(stderr, "invalid fen %s\n", argv[2]);
+      return 2;
+    }
+    printf("%s for the side to move\n", value_names[egdb_probe(&game)]);
+    return 0;
+  }
+  static EgdbSlice slices[1 << 12];
+  int slice_count = list_slices(egdb_max_pieces(), slices);
+  if (!verify(dir, slices, slice_count)) {
+    return 1;
+  }
+  time_random_probes(slices, slice_count);
+  return 0;
+}
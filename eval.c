@@ -0,0 +1,226 @@
+#include <pthread.h>
+#include <string.h>
+#include "eval.h"
+
+// bit i of the row number is set on these squares, so a man's rows
+// from its own back row add up from three popcounts
+#define ROW_BIT_0 ((Bitboard)0xF0F0F0F0)
+#define ROW_BIT_1 ((Bitboard)0xFF00FF00)
+#define ROW_BIT_2 ((Bitboard)0xFFFF0000)
+#define BACK_ROW ((Bitboard)0x0000000F)
+
+// one bitboard per position, EVAL_LANES positions side by side, which
+// the compiler maps onto whatever vector unit the target has
+// returning one is fine here, every function taking or returning them is
+// inlined, but gcc warns the result would change registers with avx
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+typedef uint32_t Lanes __attribute__((vector_size(EVAL_LANES * sizeof(uint32_t)), aligned(16)));
+
+static inline int popcount(Bitboard b) {
+  return __builtin_popcount(b);
+}
+
+// turns the board half a turn, square sq becomes 31 - sq, so the side
+// that moves towards y - 1 moves towards y + 1 instead
+static inline Bitboard rotate_board(Bitboard b) {
+  b = ((b >> 1) & 0x55555555) | ((b & 0x55555555) << 1);
+  b = ((b >> 2) & 0x33333333) | ((b & 0x33333333) << 2);
+  b = ((b >> 4) & 0x0F0F0F0F) | ((b & 0x0F0F0F0F) << 4);
+  b = ((b >> 8) & 0x00FF00FF) | ((b & 0x00FF00FF) << 8);
+  return (b >> 16) | (b << 16);
+}
+
+static inline Bitboard oriented(Bitboard b, int player_idx) {
+  return player_direction(player_idx) == UP ? b : rotate_board(b);
+}
+
+static inline int row_sum(Bitboard b) {
+  return popcount(b & ROW_BIT_0) + 2 * popcount(b & ROW_BIT_1) + 4 * popcount(b & ROW_BIT_2);
+}
+
+// every term of one side whose men move towards y + 1
+static int side_score(Bitboard men, Bitboard kings, Bitboard enemy) {
+  Bitboard pieces = men | kings;
+  Bitboard empty = ~(pieces | enemy);
+  int mobility = popcount(shift_up_left(pieces) & empty) + popcount(shift_up_right(pieces) & empty) +
+                 popcount(shift_down_left(kings) & empty) + popcount(shift_down_right(kings) & empty);
+  // an enemy piece can meet every man in the cone below it
+  Bitboard guarded = enemy;
+  for (int i = 1; i < BOARD_SIZE; i++) {
+    guarded |= shift_down_left(guarded) | shift_down_right(guarded);
+  }
+  Bitboard runaways = men & ~guarded;
+  return MAN_VALUE * popcount(men) + KING_VALUE * popcount(kings) +
+         BACK_RANK_VALUE * popcount(men & BACK_ROW) + MOBILITY_VALUE * mobility + TEMPO_VALUE * row_sum(men) +
+         RUNAWAY_VALUE * popcount(runaways) + RUNAWAY_ROW_VALUE * row_sum(runaways);
+}
+
+int evaluate(const GameState *game) {
+  int side = game->current_player;
+  int other = enemy_of(side);
+  const Player *own = &game->players[side];
+  const Player *enemy = &game->players[other];
+  return side_score(oriented(own->men, side), oriented(own->kings, side), oriented(player_pieces(enemy), side)) -
+         side_score(oriented(enemy->men, other), oriented(enemy->kings, other), oriented(player_pieces(own), other));
+}
+
+// the same terms as above, lane by lane, every helper is forced inline
+// so each kernel below compiles it for its own instruction set, vectors
+// go in by pointer since gcc notes the calling convention for passing
+// them by value on x86 even when no real call is left
+#define LANES_INLINE static inline __attribute__((always_inline))
+
+LANES_INLINE Lanes lanes_popcount(const Lanes *b) {
+  Lanes v = *b;
+  v = v - ((v >> 1) & 0x55555555);
+  v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+  v = (v + (v >> 4)) & 0x0F0F0F0F;
+  return (v * 0x01010101) >> 24;
+}
+
+LANES_INLINE Lanes lanes_popcount_and(const Lanes *b, const Lanes *mask) {
+  Lanes v = *b & *mask;
+  return lanes_popcount(&v);
+}
+
+LANES_INLINE Lanes lanes_rotate(const Lanes *b) {
+  Lanes v = *b;
+  v = ((v >> 1) & 0x55555555) | ((v & 0x55555555) << 1);
+  v = ((v >> 2) & 0x33333333) | ((v & 0x33333333) << 2);
+  v = ((v >> 4) & 0x0F0F0F0F) | ((v & 0x0F0F0F0F) << 4);
+  v = ((v >> 8) & 0x00FF00FF) | ((v & 0x00FF00FF) << 8);
+  return (v >> 16) | (v << 16);
+}
+
+LANES_INLINE Lanes lanes_up_left(const Lanes *b) {
+  return ((*b & EVEN_ROWS) << 4) | ((*b & ODD_ROWS_NOT_LEFT) << 3);
+}
+
+LANES_INLINE Lanes lanes_up_right(const Lanes *b) {
+  return ((*b & EVEN_ROWS_NOT_RIGHT) << 5) | ((*b & ODD_ROWS) << 4);
+}
+
+LANES_INLINE Lanes lanes_down_left(const Lanes *b) {
+  return ((*b & EVEN_ROWS) >> 4) | ((*b & ODD_ROWS_NOT_LEFT) >> 5);
+}
+
+LANES_INLINE Lanes lanes_down_right(const Lanes *b) {
+  return ((*b & EVEN_ROWS_NOT_RIGHT) >> 3) | ((*b & ODD_ROWS) >> 4);
+}
+
+LANES_INLINE Lanes lanes_row_sum(const Lanes *b) {
+  Lanes bit0 = *b & ROW_BIT_0, bit1 = *b & ROW_BIT_1, bit2 = *b & ROW_BIT_2;
+  return lanes_popcount(&bit0) + 2 * lanes_popcount(&bit1) + 4 * lanes_popcount(&bit2);
+}
+
+// rotates the lanes whose mask is set
+LANES_INLINE Lanes lanes_oriented(const Lanes *b, const Lanes *rotate) {
+  return (*b & ~*rotate) | (lanes_rotate(b) & *rotate);
+}
+
+LANES_INLINE Lanes lanes_side_score(const Lanes *men, const Lanes *kings, const Lanes *enemy) {
+  Lanes pieces = *men | *kings;
+  Lanes empty = ~(pieces | *enemy);
+  Lanes up_left = lanes_up_left(&pieces), up_right = lanes_up_right(&pieces);
+  Lanes down_left = lanes_down_left(kings), down_right = lanes_down_right(kings);
+  Lanes mobility = lanes_popcount_and(&up_left, &empty) + lanes_popcount_and(&up_right, &empty) +
+                   lanes_popcount_and(&down_left, &empty) + lanes_popcount_and(&down_right, &empty);
+  Lanes guarded = *enemy;
+  for (int i = 1; i < BOARD_SIZE; i++) {
+    guarded |= lanes_down_left(&guarded) | lanes_down_right(&guarded);
+  }
+  Lanes runaways = *men & ~guarded;
+  Lanes back_row = *men & BACK_ROW;
+  return MAN_VALUE * lanes_popcount(men) + KING_VALUE * lanes_popcount(kings) +
+         BACK_RANK_VALUE * lanes_popcount(&back_row) + MOBILITY_VALUE * mobility + TEMPO_VALUE * lanes_row_sum(men) +
+         RUNAWAY_VALUE * lanes_popcount(&runaways) + RUNAWAY_ROW_VALUE * lanes_row_sum(&runaways);
+}
+
+// scores EVAL_LANES positions, gathered from structs into one vector per field
+LANES_INLINE void score_lanes(const GameState *games, int *scores) {
+  uint32_t own_men[EVAL_LANES], own_kings[EVAL_LANES], enemy_men[EVAL_LANES], enemy_kings[EVAL_LANES];
+  uint32_t rotate[EVAL_LANES];
+  for (int i = 0; i < EVAL_LANES; i++) {
+    const GameState *g = &games[i];
+    const Player *own = &g->players[g->current_player];
+    const Player *enemy = &g->players[enemy_of(g->current_player)];
+    own_men[i] = own->men;
+    own_kings[i] = own->kings;
+    enemy_men[i] = enemy->men;
+    enemy_kings[i] = enemy->kings;
+    // set where the side to move is the one heading towards y - 1
+    rotate[i] = player_direction(g->current_player) == UP ? 0 : ~(uint32_t)0;
+  }
+  Lanes om, ok, em, ek, r;
+  memcpy(&om, own_men, sizeof(om));
+  memcpy(&ok, own_kings, sizeof(ok));
+  memcpy(&em, enemy_men, sizeof(em));
+  memcpy(&ek, enemy_kings, sizeof(ek));
+  memcpy(&r, rotate, sizeof(r));
+  Lanes not_r = ~r, own_pieces = om | ok, enemy_pieces = em | ek;
+  // each side seen with its own men moving up
+  Lanes own_men_up = lanes_oriented(&om, &r), own_kings_up = lanes_oriented(&ok, &r);
+  Lanes enemy_men_up = lanes_oriented(&em, &not_r), enemy_kings_up = lanes_oriented(&ek, &not_r);
+  Lanes enemy_for_own = lanes_oriented(&enemy_pieces, &r), own_for_enemy = lanes_oriented(&own_pieces, &not_r);
+  Lanes own_score = lanes_side_score(&own_men_up, &own_kings_up, &enemy_for_own);
+  Lanes enemy_score = lanes_side_score(&enemy_men_up, &enemy_kings_up, &own_for_enemy);
+  Lanes diff = own_score - enemy_score;
+  uint32_t out[EVAL_LANES];
+  memcpy(out, &diff, sizeof(out));
+  for (int i = 0; i < EVAL_LANES; i++) {
+    scores[i] = (int32_t)out[i];
+  }
+}
+
+static void batch_generic(const GameState *games, int count, int *scores) {
+  for (int i = 0; i + EVAL_LANES <= count; i += EVAL_LANES) {
+    score_lanes(games + i, scores + i);
+  }
+}
+
+typedef void (*BatchKernel)(const GameState *games, int count, int *scores);
+
+#if defined(__x86_64__) && defined(__GNUC__)
+// the generic kernel already uses sse2, which every x86-64 has, this
+// one is picked at run time where the cpu also has avx2
+__attribute__((target("avx2"))) static void batch_avx2(const GameState *games, int count, int *scores) {
+  for (int i = 0; i + EVAL_LANES <= count; i += EVAL_LANES) {
+    score_lanes(games + i, scores + i);
+  }
+}
+#endif
+
+// picked once, the first evaluate_batch of any thread waits for it
+static BatchKernel kernel;
+static const char *kernel_name;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static void pick_kernel(void) {
+#if defined(__x86_64__) && defined(__GNUC__)
+  if (__builtin_cpu_supports("avx2")) {
+    kernel_name = "avx2";
+    kernel = batch_avx2;
+    return;
+  }
+  kernel_name = "sse2";
+#else
+  kernel_name = "generic vector";
+#endif
+  kernel = batch_generic;
+}
+
+const char *evaluate_batch_kernel(void) {
+  pthread_once(&kernel_once, pick_kernel);
+  return kernel_name;
+}
+
+void evaluate_batch(const GameState *games, int count, int *scores) {
+  pthread_once(&kernel_once, pick_kernel);
+  kernel(games, count, scores);
+  // what does not fill a whole vector is scored one at a time
+  for (int i = count - count % EVAL_LANES; i < count; i++) {
+    scores[i] = evaluate(&games[i]);
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "board.h"
+
+#define MAN_VALUE 100
+#define KING_VALUE 130
+// men still on their own back row keep the enemy from crowning
+#define BACK_RANK_VALUE 6
+// per empty square a piece could step to
+#define MOBILITY_VALUE 2
+// per row a man has advanced
+#define TEMPO_VALUE 2
+// a man no enemy piece stands in front of will crown, worth more the
+// closer it already is
+#define RUNAWAY_VALUE 30
+#define RUNAWAY_ROW_VALUE 5
+
+// positions evaluate_batch scores at once, one per 32 bit vector lane
+#define EVAL_LANES 8
+
+// static score of game from the point of view of the side to move
+int evaluate(const GameState *game);
+// scores count positions into scores, the same values evaluate gives,
+// with the vector unit working on EVAL_LANES positions at a time
+void evaluate_batch(const GameState *games, int count, int *scores);
+// which batch kernel this machine runs, for benchmarks
+const char *evaluate_batch_kernel(void);
+
+#endif
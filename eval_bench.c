@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "board.h"
+#include "moves.h"
+#include "eval.h"
+#include "timeman.h"
+
+#define DEFAULT_POSITIONS 1000000
+// every position is scored this many times so short runs still time well
+#define ROUNDS 20
+
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+// positions from random games, so every phase and side to move shows up
+static void random_positions(GameState *positions, int count) {
+  uint64_t random = 0x9E3779B97F4A7C15ULL;
+  GameState game;
+  game_init(&game);
+  for (int i = 0; i < count; i++) {
+    MoveList moves;
+    int move_count = generate_moves(&game, &moves);
+    if (move_count == 0) {
+      game_init(&game);
+      move_count = generate_moves(&game, &moves);
+    }
+    make_move(&game, &moves.moves[next_random(&random) % move_count]);
+    positions[i] = game;
+  }
+}
+
+int main(int argc, char **argv) {
+  int count = argc > 1 ? atoi(argv[1]) : DEFAULT_POSITIONS;
+  if (count < 1) {
+    fprintf(stderr, "usage: %s [positions]\n", argv[0]);
+    return 2;
+  }
+  GameState *positions = malloc(count * sizeof(GameState));
+  int *single = malloc(count * sizeof(int));
+  int *batched = malloc(count * sizeof(int));
+  random_positions(positions, count);
+
+  double start = now_seconds();
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < count; i++) {
+      single[i] = evaluate(&positions[i]);
+    }
+  }
+  double single_time = now_seconds() - start;
+
+  start = now_seconds();
+  for (int round = 0; round < ROUNDS; round++) {
+    evaluate_batch(positions, count, batched);
+  }
+  double batch_time = now_seconds() - start;
+
+  int mismatches = 0;
+  for (int i = 0; i < count; i++) {
+    mismatches += single[i] != batched[i];
+  }
+  double evaluations = (double)count * ROUNDS;
+  printf("%d positions, %d rounds\n", count, ROUNDS);
+  printf("single:  %6.1f Mpositions/s, %.1f ns each\n", evaluations / single_time / 1e6, single_time / evaluations * 1e9);
+  printf("batched: %6.1f Mpositions/s, %.1f ns each, %d lanes, %s kernel, %.2fx\n", evaluations / batch_time / 1e6,
+         batch_time / evaluations * 1e9, EVAL_LANES, evaluate_batch_kernel(), single_time / batch_time);
+  if (mismatches) {
+    printf("%d positions scored differently by the two paths\n", mismatches);
+    return 1;
+  }
+  printf("both paths agree on every position\n");
+  free(positions);
+  free(single);
+  free(batched);
+  return 0;
+}
@@ -0,0 +1,320 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+#include "protocol.h"
+#include "timeman.h"
+
+#define DEFAULT_CONNECTIONS 8
+#define DEFAULT_GAMES_IN_FLIGHT 64
+#define DEFAULT_TOTAL_GAMES 10000
+#define MAX_CONNECTIONS 1024
+#define READ_BUFFER_SIZE 65536
+
+// one game a connection keeps going, it plays both sides
+typedef struct ClientGame {
+  Game game;
+  uint32_t id;
+  // when the last move was sent, its reply closes the latency sample
+  double sent_at;
+  bool active;
+} ClientGame;
+
+typedef struct Client {
+  int fd;
+  ClientGame *games;
+  // the server answers in order, so new games get their ids in the
+  // order they were requested
+  int *awaiting_id;
+  int awaiting_head;
+  int awaiting_count;
+  uint8_t in[READ_BUFFER_SIZE];
+  size_t in_length;
+  // messages go out in one write after each batch of replies, a game in
+  // flight adds either a move or a leave and a new game request
+  uint8_t *out;
+  size_t out_length;
+  uint64_t random;
+} Client;
+
+typedef struct LoadStats {
+  int games_in_flight;
+  int total_games;
+  int games_started;
+  int games_finished;
+  int results[GAME_DRAW + 1];
+  uint64_t errors;
+  uint64_t mismatches;
+  double *latencies;
+  size_t latency_count;
+  size_t latency_capacity;
+} LoadStats;
+
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+static void queue_message(Client *c, const Message *m) {
+  c->out_length += message_encode(m, c->out + c->out_length, PROTOCOL_MAX_MESSAGE);
+}
+
+static void flush_or_die(Client *c) {
+  size_t sent = 0;
+  while (sent < c->out_length) {
+    ssize_t n = write(c->fd, c->out + sent, c->out_length - sent);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      perror("write");
+      exit(1);
+    }
+    sent += n;
+  }
+  c->out_length = 0;
+}
+
+static void request_game(Client *c, LoadStats *stats, int slot) {
+  Message m = {.type = MSG_NEW_GAME, .seats = SEAT_PLAYER_ONE | SEAT_PLAYER_TWO};
+  int games_in_flight = stats->games_in_flight;
+  c->awaiting_id[(c->awaiting_head + c->awaiting_count++) % games_in_flight] = slot;
+  stats->games_started++;
+  queue_message(c, &m);
+}
+
+// plays a random legal move of the side to move in g
+static void send_move(Client *c, ClientGame *g) {
+  MoveList moves;
+  int count = generate_moves(&g->game.state, &moves);
+  Message m = {.type = MSG_MOVE, .game_id = g->id};
+  wire_move_from_move(&moves.moves[next_random(&c->random) % count], &m.move);
+  g->sent_at = now_seconds();
+  queue_message(c, &m);
+}
+
+static void record_latency(LoadStats *stats, double latency) {
+  if (stats->latency_count == stats->latency_capacity) {
+    stats->latency_capacity = stats->latency_capacity ? stats->latency_capacity * 2 : 65536;
+    stats->latencies = realloc(stats->latencies, stats->latency_capacity * sizeof(double));
+  }
+  stats->latencies[stats->latency_count++] = latency;
+}
+
+static void finish_game(Client *c, LoadStats *stats, ClientGame *g, int slot) {
+  stats->games_finished++;
+  stats->results[g->game.result]++;
+  g->active = false;
+  Message leave = {.type = MSG_LEAVE, .game_id = g->id};
+  queue_message(c, &leave);
+  if (stats->games_started < stats->total_games) {
+    request_game(c, stats, slot);
+  }
+}
+
+static ClientGame *find_client_game(Client *c, LoadStats *stats, uint32_t id, int *slot) {
+  for (int i = 0; i < stats->games_in_flight; i++) {
+    if (c->games[i].active && c->games[i].id == id) {
+      *slot = i;
+      return &c->games[i];
+    }
+  }
+  return NULL;
+}
+
+static void handle_reply(Client *c, LoadStats *stats, const Message *m) {
+  int slot;
+  ClientGame *g;
+  switch (m->type) {
+  case MSG_STATE:
+    slot = c->awaiting_id[c->awaiting_head];
+    c->awaiting_head = (c->awaiting_head + 1) % stats->games_in_flight;
+    c->awaiting_count--;
+    g = &c->games[slot];
+    game_start(&g->game);
+    g->id = m->game_id;
+    g->active = true;
+    send_move(c, g);
+    break;
+  case MSG_MOVED: {
+    double now = now_seconds();
+    g = find_client_game(c, stats, m->game_id, &slot);
+    if (!g) {
+      stats->errors++;
+      break;
+    }
+    record_latency(stats, now - g->sent_at);
+    // keep a local copy in step with the server and check its diff
+    MoveList moves;
+    generate_moves(&g->game.state, &moves);
+    const Move *move = find_wire_move(&moves, &m->move);
+    // a game whose copy went out of step is given up, so the run still ends
+    if (!move || move->captured != m->captured || move->promotes != m->promotes) {
+      stats->mismatches++;
+      finish_game(c, stats, g, slot);
+      break;
+    }
+    game_play(&g->game, move);
+    if (g->game.result != m->result) {
+      stats->mismatches++;
+    }
+    if (m->result != GAME_ONGOING || g->game.result != GAME_ONGOING) {
+      finish_game(c, stats, g, slot);
+    } else {
+      send_move(c, g);
+    }
+    break;
+  }
+  default:
+    stats->errors++;
+    fprintf(stderr, "server error %d for game %u\n", m->error, m->game_id);
+    exit(1);
+  }
+}
+
+// connects to the first of addresses that accepts, errno tells why none did
+static int connect_to(const struct addrinfo *addresses) {
+  for (const struct addrinfo *a = addresses; a; a = a->ai_next) {
+    int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      continue;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+  }
+  return -1;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(const LoadStats *stats, double p) {
+  size_t index = (size_t)(p * (stats->latency_count - 1));
+  return stats->latencies[index];
+}
+
+int main(int argc, char **argv) {
+  const char *host = argc > 1 ? argv[1] : "127.0.0.1";
+  int port = argc > 2 ? atoi(argv[2]) : DEFAULT_PORT;
+  int connection_count = argc > 3 ? atoi(argv[3]) : DEFAULT_CONNECTIONS;
+  LoadStats stats = {
+    .games_in_flight = argc > 4 ? atoi(argv[4]) : DEFAULT_GAMES_IN_FLIGHT,
+    .total_games = argc > 5 ? atoi(argv[5]) : DEFAULT_TOTAL_GAMES,
+  };
+  if (connection_count < 1 || connection_count > MAX_CONNECTIONS ||
+      stats.games_in_flight < 1 || stats.total_games < 1) {
+    fprintf(stderr, "usage: %s [host] [port] [connections] [games in flight per connection] [total games]\n", argv[0]);
+    return 2;
+  }
+  // looked up once, every connection goes to the same server
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+  struct addrinfo *addresses;
+  int lookup = getaddrinfo(host, service, &hints, &addresses);
+  if (lookup != 0) {
+    fprintf(stderr, "could not resolve %s: %s\n", host, gai_strerror(lookup));
+    return 1;
+  }
+  static Client clients[MAX_CONNECTIONS];
+  static struct pollfd polls[MAX_CONNECTIONS];
+  for (int i = 0; i < connection_count; i++) {
+    Client *c = &clients[i];
+    c->fd = connect_to(addresses);
+    if (c->fd < 0) {
+      fprintf(stderr, "could not connect to %s:%d: %s\n", host, port, strerror(errno));
+      return 1;
+    }
+    c->games = calloc(stats.games_in_flight, sizeof(ClientGame));
+    c->awaiting_id = calloc(stats.games_in_flight, sizeof(int));
+    c->out = malloc(stats.games_in_flight * 3 * PROTOCOL_MAX_MESSAGE);
+    c->random = 0x9E3779B97F4A7C15ULL * (i + 1);
+    polls[i].fd = c->fd;
+    polls[i].events = POLLIN;
+  }
+  freeaddrinfo(addresses);
+
+  double start = now_seconds();
+  for (int slot = 0; slot < stats.games_in_flight; slot++) {
+    for (int i = 0; i < connection_count && stats.games_started < stats.total_games; i++) {
+      request_game(&clients[i], &stats, slot);
+    }
+  }
+  for (int i = 0; i < connection_count; i++) {
+    flush_or_die(&clients[i]);
+  }
+  while (stats.games_finished < stats.total_games) {
+    if (poll(polls, connection_count, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("poll");
+      return 1;
+    }
+    for (int i = 0; i < connection_count; i++) {
+      if (!(polls[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+        continue;
+      }
+      Client *c = &clients[i];
+      ssize_t n = read(c->fd, c->in + c->in_length, sizeof(c->in) - c->in_length);
+      if (n <= 0) {
+        fprintf(stderr, "server closed the connection\n");
+        return 1;
+      }
+      c->in_length += n;
+      size_t used = 0;
+      Message m;
+      int length;
+      while ((length = message_decode(c->in + used, c->in_length - used, &m)) > 0) {
+        handle_reply(c, &stats, &m);
+        used += length;
+      }
+      if (length < 0) {
+        fprintf(stderr, "malformed message from server\n");
+        return 1;
+      }
+      memmove(c->in, c->in + used, c->in_length - used);
+      c->in_length -= used;
+      flush_or_die(c);
+    }
+  }
+  double elapsed = now_seconds() - start;
+
+  qsort(stats.latencies, stats.latency_count, sizeof(double), compare_doubles);
+  printf("%d games over %d connections, %d in flight each, %.2f s\n",
+         stats.games_finished, connection_count, stats.games_in_flight, elapsed);
+  printf("red wins %d, black wins %d, draws %d\n", stats.results[GAME_PLAYER_ONE_WINS],
+         stats.results[GAME_PLAYER_TWO_WINS], stats.results[GAME_DRAW]);
+  printf("%.0f games/s, %.0f moves/s\n", stats.games_finished / elapsed, stats.latency_count / elapsed);
+  printf("move latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+         percentile(&stats, 0.50) * 1e6, percentile(&stats, 0.99) * 1e6,
+         stats.latencies[stats.latency_count - 1] * 1e6);
+  if (stats.mismatches || stats.errors) {
+    printf("%llu replies disagreed with the local rules, %llu errors\n",
+           (unsigned long long)stats.mismatches, (unsigned long long)stats.errors);
+    return 1;
+  }
+  return 0;
+}
@@ -1,101 +1,57 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
 #include <raylib.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+#include "search.h"
+#include "egdb.h"
+#include "book.h"
+#include "nnue.h"
+#include "protocol.h"
+#include "net.h"
 
-#define PLAYER_CHECKER_COUNT 12
-#define PLAYER_COUNT 2
 #define BACKGROUND_COLOR (Color) {175, 128, 79, 255}
-#define START_PLAYER_IDX 1
-#define PLAYER_ONE 0
-#define PLAYER_TWO 1
-#define BOARD_SIZE 8
-#define MAX_JUMP_COUNT 10
-
-typedef struct Position {
-  int x;
-  int y;
-}Position;
-
-
-typedef struct PositionPair {
-  Position enemy;
-  Position land_on;
-}PositionPair;
-
-typedef enum PieceType {
-  PAWN,
-  KING,
-} PieceType;
-
-typedef enum Direction {
-  UP,
-  DOWN
-} Direction;
-
-typedef struct Checker {
-  Position pos;
-  // TODO: could remove this and just set pos to -1 -1 or something
-  bool is_alive;
-}Checker;
-
-typedef struct Player {
-  Checker cs[PLAYER_CHECKER_COUNT];
-  Color c;
-  int selected_piece;
-}Player;
-
-typedef struct GameState {
-  Player players[PLAYER_COUNT];
-  bool is_game_over;
-  Player *current_player;
-} GameState;
-
-void player_init(Player *p, Color c, int start_row) {
-  p->c = c;
-  p->selected_piece = -1;
-  int placed_piece_count = 0;
-  for (int r = start_row; r < start_row + 3; r++) {
-    for (int c = 0; c < 8; c++) {
-      if ((r + c) % 2 == 1) {
-        p->cs[placed_piece_count] = (Checker) {
-          .pos = {c, r},
-          .is_alive = true,
-        };
-        placed_piece_count++;
-      }
-    }
-  }
-}
+#define COMPUTER_MOVE_TIME 1.0
 
-void game_init(GameState *game) {
-  for (int i = 0; i < PLAYER_COUNT; i++) {
-    Color c;
-    int start_row;
-    if (i == 0) {
-      c = RED;
-      start_row = 0;
-    } else {
-      c = BLACK;
-      start_row = 5;
-    }
-    player_init(&game->players[i], c, start_row);
-  }
-  // start with black colored checkers
-  game->current_player = &game->players[START_PLAYER_IDX];
+int computer_threads = 1;
+Book book;
+// scores positions instead of the handcrafted evaluation once loaded
+NnueNetwork network;
+
+// online the server decides which moves stand and how the game ends,
+// this window only plays the seats it holds
+NetClient net;
+bool online = false;
+// the server has sent the game, so its id and position are known
+bool net_ready = false;
+bool net_lost = false;
+uint8_t net_seats = 0;
+uint32_t net_game_id = 0;
+
+Color player_color(int player_idx) {
+  return (player_idx == PLAYER_ONE) ? RED : BLACK;
 }
 
-void draw_checkers(Player p, int grid_size, Position board_start, int checker_radius) {
-  for (int i = 0; i < PLAYER_CHECKER_COUNT; i++) {
-    Checker c = p.cs[i];
-    if (c.is_alive) {
-      int x_offset = p.cs[i].pos.x * grid_size + board_start.x;
-      int y_offset = p.cs[i].pos.y * grid_size + board_start.y;
-      DrawCircle(x_offset + grid_size/2, y_offset + grid_size/2, checker_radius, p.c);
+void draw_checkers(Player p, Color color, int grid_size, Position board_start, int checker_radius) {
+  Bitboard pieces = player_pieces(&p);
+  while (pieces) {
+    int sq = __builtin_ctz(pieces);
+    pieces &= pieces - 1;
+    Position pos = position_from_square(sq);
+    int x_offset = pos.x * grid_size + board_start.x;
+    int y_offset = pos.y * grid_size + board_start.y;
+    DrawCircle(x_offset + grid_size/2, y_offset + grid_size/2, checker_radius, color);
+    if (p.kings & SQUARE_BIT(sq)) {
+      DrawCircleLines(x_offset + grid_size/2, y_offset + grid_size/2, checker_radius/2, GOLD);
     }
   }
 }
 
-void display_board(GameState game, int grid_count, int grid_size, Position board_start) {
+void display_board(const GameState *game, int grid_count, int grid_size, Position board_start) {
   // draw grid
   for (int x = 0; x < grid_count; x++) {
     for (int y = 0; y < grid_count; y++) {
@@ -113,20 +69,10 @@ void display_board(GameState game, int grid_count, int grid_size, Position board
     }
   }
   for (int i = 0; i < PLAYER_COUNT; i++) {
-    draw_checkers(game.players[i], grid_size, board_start, 2.f*(float)grid_size/5.f);
+    draw_checkers(game->players[i], player_color(i), grid_size, board_start, 2.f*(float)grid_size/5.f);
   }
 }
 
-void player_move(Player *p, int *current_player) {
-  // perform move
-  
-  // change current_player_turn
-  // this is only needed for local play
-  // otherwise only server should determine current player
-  *current_player = *current_player + 1;
-  *current_player %= 1;
-}
-
 Position get_current_xy_coords_hovering(Vector2 mouse_pos, int grid_count, int grid_size, Position board_start) {
   for (int x = 0; x < grid_count; x++) {
     for (int y = 0; y < grid_count; y++) {
@@ -145,186 +91,382 @@ Position get_current_xy_coords_hovering(Vector2 mouse_pos, int grid_count, int g
   return (Position) {-1, -1};
 }
 
+// landing squares clicked since the piece was selected, and once several
+// capture paths end on the clicked square, that square, which the clicks
+// after it then lead up to until only one path is left
+int clicked_path[MAX_JUMP_COUNT + 1];
+int clicked_count = 0;
+int clicked_end = -1;
+
+void player_select_piece(Player *curr_player, Vector2 mouse_pos, int grid_size, Position board_start) {
+  Bitboard pieces = player_pieces(curr_player);
+  while (pieces) {
+    int sq = __builtin_ctz(pieces);
+    pieces &= pieces - 1;
+    Position pos = position_from_square(sq);
+    Rectangle checker_rect = {
+      pos.x * grid_size + board_start.x,
+      pos.y * grid_size + board_start.y,
+      grid_size,
+      grid_size};
+    // draw rectangle around selected piece
+    if (CheckCollisionPointRec(mouse_pos, checker_rect) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+      curr_player->selected_piece = sq;
+      clicked_count = 0;
+      clicked_end = -1;
+    }
+  }
+}
+
+void draw_selected_checker_board(Player *curr_player, int grid_size, Position board_start) {
+  int selected_piece = curr_player->selected_piece;
+  if (selected_piece != -1) {
+    Position pos = position_from_square(selected_piece);
+    Rectangle checker_rect = {
+      pos.x * grid_size + board_start.x,
+      pos.y * grid_size + board_start.y,
+      grid_size,
+      grid_size};
+      DrawRectangleLinesEx(checker_rect, 5.f, BLACK);
+  }
+}
+
+// whether the side to move is played from this window
+bool is_local_turn(const Game *game) {
+  if (!online) {
+    return true;
+  }
+  return net_ready && !net_lost && (net_seats & (1 << game->state.current_player));
+}
+
+// the move shows at once, online the server confirms it frames later
+void play_move(Game *game, const Move *move) {
+  if (online) {
+    Message m = {.type = MSG_MOVE, .game_id = net_game_id};
+    wire_move_from_move(move, &m.move);
+    net_send(&net, &m);
+  }
+  game_play(game, move);
+}
 
-bool is_empty_space(GameState game, Position board_idx) {
+// asks for the whole position again after the local copy went astray
+void resync(void) {
+  Message join = {.type = MSG_JOIN, .game_id = net_game_id, .seats = net_seats};
+  net_send(&net, &join);
+}
+
+void apply_server_state(Game *game, const Message *m) {
+  GameState state = game->state;
   for (int i = 0; i < PLAYER_COUNT; i++) {
-    Player p = game.players[i];
-    for (int c = 0; c < PLAYER_CHECKER_COUNT; c++) {
-      Position checker_pos = p.cs[c].pos;
-      if (checker_pos.x == board_idx.x && checker_pos.y == board_idx.y) {
-        return false;
+    state.players[i].men = m->men[i];
+    state.players[i].kings = m->kings[i];
+    state.players[i].selected_piece = -1;
+  }
+  state.current_player = m->current_player;
+  game_resume(game, &state, m->ply);
+  game->result = m->result;
+  if (!net_ready) {
+    printf("playing game %u, join it with --join %u\n", m->game_id, m->game_id);
+  }
+  net_game_id = m->game_id;
+  net_ready = true;
+}
+
+void apply_server_move(Game *game, const Message *m) {
+  // moves from this window were played when they were sent
+  if (m->ply > game->ply) {
+    MoveList moves;
+    generate_moves(&game->state, &moves);
+    const Move *move = find_wire_move(&moves, &m->move);
+    if (!move || m->ply != game->ply + 1) {
+      resync();
+      return;
+    }
+    game_play(game, move);
+  }
+  // draws by repetition are only known to the server
+  if (m->ply == game->ply) {
+    game->result = m->result;
+  }
+}
+
+// takes whatever the server sent since the last frame, never waits for it
+void network_update(Game *game) {
+  if (!net_poll(&net) && !net_lost) {
+    fprintf(stderr, "lost the connection to the server\n");
+    net_lost = true;
+  }
+  Message m;
+  while (net_receive(&net, &m)) {
+    switch (m.type) {
+    case MSG_STATE:
+      apply_server_state(game, &m);
+      break;
+    case MSG_MOVED:
+      apply_server_move(game, &m);
+      break;
+    case MSG_ERROR:
+      fprintf(stderr, "server refused a request, error %d\n", m.error);
+      if (net_ready) {
+        resync();
       }
+      break;
+    default:
+      break;
     }
   }
-  return true;
 }
 
-bool contains_enemy(GameState *game, int enemy_idx, Position pos) {
-  Player enemy = game->players[enemy_idx];
-  for (int c = 0; c < PLAYER_CHECKER_COUNT; c++) {
-    Position enemy_pos = enemy.cs[c].pos;
-    if (enemy_pos.x == pos.x && enemy_pos.y == pos.y) {
-      printf("Contains enemy piece!\n");
-      return true;
+// adds a clicked square to the path of the selected piece, the move once
+// the path names exactly one
+const Move *click_square(const MoveList *moves, int from, int sq) {
+  const Move *move;
+  int found = 0;
+  if (clicked_end != -1 && clicked_count < MAX_JUMP_COUNT) {
+    clicked_path[clicked_count] = sq;
+    clicked_path[clicked_count + 1] = clicked_end;
+    found = find_moves(moves, from, clicked_path, clicked_count + 2, &move);
+    if (found > 1) {
+      clicked_count++;
+      return NULL;
+    }
+  }
+  if (!found && clicked_end == -1 && clicked_count < MAX_JUMP_COUNT) {
+    clicked_path[clicked_count] = sq;
+    found = find_moves(moves, from, clicked_path, clicked_count + 1, &move);
+    if (found > 1) {
+      printf("%d captures end there, click the squares one of them lands on in order\n", found);
+      clicked_end = sq;
+      return NULL;
+    }
+    if (!found && move_continues(moves, from, clicked_path, clicked_count + 1)) {
+      clicked_count++;
+      return NULL;
     }
   }
-  return false;
+  // a click off every path starts a new one
+  if (!found && (clicked_count || clicked_end != -1)) {
+    clicked_count = 0;
+    clicked_end = -1;
+    return click_square(moves, from, sq);
+  }
+  clicked_count = 0;
+  clicked_end = -1;
+  return found ? move : NULL;
 }
 
-void simulate_jump(GameState *game, int enemy_idx,
-                   Position start, Position end, 
-                   Direction dir, 
-                   bool visited[BOARD_SIZE][BOARD_SIZE],
-                   PositionPair path[MAX_JUMP_COUNT],
-                   int *jump_count,
-                   int *successful_jump_count) {
-  // if we are not on a dark square we can automatically ignore
-  if ((end.x + end.y) % 2 != 1) {
+void player_attempt_move(Game *game, Vector2 mouse_pos, int grid_size, int grid_count, Position board_start) {
+  Player *curr_player = &game->state.players[game->state.current_player];
+  int selected_piece = curr_player->selected_piece;
+  if (selected_piece == -1) {
     return;
   }
-  if (*jump_count >= MAX_JUMP_COUNT) {
+  // get rect at current mouse position
+  Position current_pos = get_current_xy_coords_hovering(
+    mouse_pos, grid_count, grid_size, board_start
+  );
+  if (!IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
     return;
   }
-  if (visited[start.x][start.y]) {
+  int sq = square_from_position(current_pos);
+  if (sq < 0) {
     return;
   }
-  if (start.x == end.x && start.y == end.y) {
-    printf("Made it to the end!\n");
-    printf("jump count: %d\n", *jump_count);
-    *successful_jump_count = *jump_count;
-    return;
+  MoveList moves;
+  generate_moves(&game->state, &moves);
+  const Move *move = click_square(&moves, selected_piece, sq);
+  if (move) {
+    curr_player->selected_piece = -1;
+    // make move and change player_turn
+    play_move(game, move);
   }
-  visited[start.x][start.y] = true;
-  // now we need to move from the start position to the end position
-  Position current = start;
-  int dy = (dir == UP) ? 1 : -1;
-  for (int dx = -1; dx <= 1; dx+=2) {
-    Position next = {current.x + dx, current.y + dy};
-    Position jump = {next.x + dx, next.y + dy};
-    if (contains_enemy(game, enemy_idx, next) &&
-        is_empty_space(*game, jump)) {
-      printf("Simulating jump!");
-      path[*jump_count] = (PositionPair){next, jump};
-      (*jump_count)++;
-      simulate_jump(game, enemy_idx, jump, end, dir, visited, path, jump_count, successful_jump_count);
-      (*jump_count)--;
+}
+
+// the engine searches on a thread of its own so the window keeps drawing,
+// and while the human thinks it searches the position after the reply
+// its principal variation expects
+typedef enum EngineState {
+  ENGINE_IDLE,
+  ENGINE_THINKING,
+  ENGINE_PONDERING,
+} EngineState;
+
+typedef struct Engine {
+  EngineState state;
+  pthread_t thread;
+  GameState position;
+  SearchLimits limits;
+  SearchResult result;
+  int abort_flag;
+  // raised by the thread once search returns
+  int done;
+  // a thread is left to join
+  bool running;
+  // window time the search started and the one it must move by
+  double start;
+  double deadline;
+  // how pondering went for the move being searched, for its stats line
+  const char *ponder_outcome;
+} Engine;
+
+Engine engine;
+
+void *engine_thread(void *arg) {
+  Engine *e = arg;
+  search(&e->position, e->limits, &e->result);
+  __atomic_store_n(&e->done, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+// searches position until engine_stop, the caller polls engine.done
+void engine_start(EngineState state, const GameState *position) {
+  engine.state = state;
+  engine.position = *position;
+  engine.abort_flag = 0;
+  engine.done = 0;
+  engine.limits = (SearchLimits){
+    .threads = computer_threads,
+    .abort_flag = &engine.abort_flag,
+    .network = network.header ? &network : NULL,
+  };
+  engine.start = GetTime();
+  engine.deadline = engine.start + COMPUTER_MOVE_TIME;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, SEARCH_THREAD_STACK);
+  engine.running = pthread_create(&engine.thread, &attr, engine_thread, &engine) == 0;
+  pthread_attr_destroy(&attr);
+  if (!engine.running) {
+    // searched here instead, the one case the window waits, and never to ponder
+    if (state == ENGINE_PONDERING) {
+      engine.state = ENGINE_IDLE;
+      return;
     }
+    engine.limits.max_time = COMPUTER_MOVE_TIME;
+    engine_thread(&engine);
   }
-  visited[start.x][start.y] = false;
 }
 
-int get_player_checker_idx_from_position(GameState *game, Position checker_pos, int player_idx) {
-  for (int i = 0; i < PLAYER_CHECKER_COUNT; i++) {
-    Checker c = game->players[player_idx].cs[i];
-    if (c.pos.x == checker_pos.x && c.pos.y == checker_pos.y) {
-      return i;
-    }
+// an abort makes search return within a few thousand nodes, so this
+// join only ever waits for a search that is already winding down
+void engine_stop(void) {
+  if (engine.running) {
+    search_abort(&engine.abort_flag);
+    pthread_join(engine.thread, NULL);
+    engine.running = false;
   }
-  return -1;
+  engine.state = ENGINE_IDLE;
+}
+
+// ponders the human reply the search expects, when it expects one
+void engine_ponder(const Game *game, const SearchResult *result) {
+  if (result->pv_length < 2 || game->result != GAME_ONGOING ||
+      game->state.players[game->state.current_player].is_computer) {
+    return;
+  }
+  GameState predicted = game->state;
+  make_move(&predicted, &result->pv[1]);
+  engine_start(ENGINE_PONDERING, &predicted);
+}
+
+bool is_computer_turn(const Game *game) {
+  return game->state.players[game->state.current_player].is_computer && is_local_turn(game) &&
+         game->result == GAME_ONGOING;
 }
 
-bool is_valid_move(GameState *game, Position selected_board_pos) {
-  // TODO: determine what a valid move is in checkers
-  // need to check for jump first
-  // if (can_jump())
-  // simple move
-  Player *current = game->current_player;
-  Position selected_piece_pos = current->cs[current->selected_piece].pos;
-  // TODO: turn into macros
-  int curr_player_idx = (current == &game->players[PLAYER_ONE]) ? PLAYER_ONE : PLAYER_TWO;
-  int enemy_player_idx = (curr_player_idx == PLAYER_ONE) ? PLAYER_TWO : PLAYER_ONE;
-  Direction piece_dir = (curr_player_idx == PLAYER_ONE) ? UP : DOWN;
-  bool can_move_to_position = false;
-  int grid_x_diff = selected_piece_pos.x - selected_board_pos.x;
-  int grid_y_diff = selected_piece_pos.y - selected_board_pos.y;
-    // check for simple move
-  if ((grid_x_diff == -1 || grid_x_diff == 1) && (grid_y_diff == -1 || grid_y_diff == 1)) {
-    if (piece_dir == DOWN && selected_piece_pos.y > selected_board_pos.y) {
-      can_move_to_position = true;
-    } else if (piece_dir == UP && selected_piece_pos.y < selected_board_pos.y) {
-      can_move_to_position = true;
+// called once a frame, never waits for the search to finish
+void computer_update(Game *game) {
+  if (engine.state == ENGINE_PONDERING) {
+    if (game->result != GAME_ONGOING) {
+      engine_stop();
+      return;
     }
-  } else {
-    // simulate jump
-    // construct a sequence of jumps to get to selected position
-    bool visited[BOARD_SIZE][BOARD_SIZE] = {0};
-    PositionPair jump_path[MAX_JUMP_COUNT];
-    int jump_count = 0;
-    int successful_jump_count = 0;
-    simulate_jump(game, enemy_player_idx, 
-                  selected_piece_pos, selected_board_pos, 
-                  piece_dir, visited, jump_path, &jump_count, &successful_jump_count);
-    printf("jump count outside func: %d\n", successful_jump_count);
-    if (successful_jump_count) {
-      can_move_to_position = true;
+    if (!is_computer_turn(game)) {
+      return;
     }
-    for (int c = 0; c < successful_jump_count; c++) {
-      int checker_idx = get_player_checker_idx_from_position(game, jump_path[c].enemy, enemy_player_idx);
-      if (checker_idx != -1) {
-        game->players[enemy_player_idx].cs[checker_idx].is_alive = false;
-        game->players[enemy_player_idx].cs[checker_idx].pos = (Position){-1, -1};
-      }
-      printf("Checker idx %d\n", checker_idx);
-      printf("Enemy point: %d, %d\n", jump_path[c].enemy.x, jump_path[c].enemy.y);
-      printf("Land on spot: %d, %d\n", jump_path[c].land_on.x, jump_path[c].land_on.y);
+    if (!same_position(&engine.position, &game->state)) {
+      engine.ponder_outcome = ", ponder miss";
+      engine_stop();
+    } else {
+      // the time pondered counts, so a long think may answer at once
+      engine.ponder_outcome = ", ponder hit";
+      engine.state = ENGINE_THINKING;
     }
   }
-  return is_empty_space(*game, selected_board_pos) && can_move_to_position;
-}
-
-void player_select_piece(Player *curr_player, Vector2 mouse_pos, int grid_size, Position board_start) {
-  for (int i = 0; i < PLAYER_CHECKER_COUNT; i++) {
-    Checker checker = curr_player->cs[i];
-    Rectangle checker_rect = {
-      checker.pos.x * grid_size + board_start.x,
-      checker.pos.y * grid_size + board_start.y,
-      grid_size,
-      grid_size};
-    // draw rectangle around selected piece
-    if (CheckCollisionPointRec(mouse_pos, checker_rect) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-      curr_player->selected_piece = i;
-    } 
+  if (engine.state == ENGINE_THINKING) {
+    // the position changed under the search, e.g. the server resent it
+    if (!is_computer_turn(game) || !same_position(&engine.position, &game->state)) {
+      engine_stop();
+      return;
+    }
+    if (!__atomic_load_n(&engine.done, __ATOMIC_ACQUIRE) && GetTime() < engine.deadline) {
+      return;
+    }
+    engine_stop();
+    SearchResult result = engine.result;
+    char notation[64];
+    format_move(&result.best_move, notation, sizeof(notation));
+    printf("computer plays %s: depth %d, score %d, %llu nodes (%llu quiescence), %.0f nodes/s, hashfull %d, "
+           "egdb hits %llu%s\n",
+           notation, result.depth, result.score, (unsigned long long)result.nodes,
+           (unsigned long long)result.quiescence_nodes, result.nodes_per_second, result.hashfull,
+           (unsigned long long)result.egdb_hits, engine.ponder_outcome ? engine.ponder_outcome : "");
+    engine.ponder_outcome = NULL;
+    play_move(game, &result.best_move);
+    engine_ponder(game, &result);
+    return;
+  }
+  if (!is_computer_turn(game)) {
+    return;
   }
+  // known openings are played straight away
+  BookMove book_moves[BOOK_MAX_MOVES];
+  if (book_probe(&book, &game->state, book_moves, BOOK_MAX_MOVES) > 0) {
+    char notation[64];
+    format_move(&book_moves[0].move, notation, sizeof(notation));
+    printf("computer plays %s from the book: %u games, score %.3f\n",
+           notation, book_moves[0].games, book_moves[0].score);
+    engine.ponder_outcome = NULL;
+    play_move(game, &book_moves[0].move);
+    return;
+  }
+  engine_start(ENGINE_THINKING, &game->state);
 }
 
-void draw_selected_checker_board(Player *curr_player, int grid_size, Position board_start) {
-  int selected_piece = curr_player->selected_piece;
-  if (selected_piece != -1) {
-    Checker checker = curr_player->cs[selected_piece];
-    Rectangle checker_rect = {
-      checker.pos.x * grid_size + board_start.x,
-      checker.pos.y * grid_size + board_start.y,
-      grid_size,
-      grid_size};
-      DrawRectangleLinesEx(checker_rect, 5.f, BLACK);
+void draw_result(GameResult result) {
+  static const char *messages[] = {
+    [GAME_PLAYER_ONE_WINS] = "Red wins",
+    [GAME_PLAYER_TWO_WINS] = "Black wins",
+    [GAME_DRAW] = "Draw",
+  };
+  if (result != GAME_ONGOING) {
+    DrawText(messages[result], 150, 560, 30, DARKGRAY);
   }
 }
 
-void player_attempt_move(GameState *game, Vector2 mouse_pos, int grid_size, int grid_count, Position board_start) {
-  Player *curr_player = game->current_player;
-  int selected_piece = curr_player->selected_piece;
-  if (selected_piece == -1) {
+void draw_network_status(void) {
+  if (!online) {
     return;
   }
-  // get rect at current mouse position
-  Position current_pos = get_current_xy_coords_hovering(
-    mouse_pos, grid_count, grid_size, board_start 
-  );
-  if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && is_valid_move(game, current_pos)) {
-    // make move
-    curr_player->cs[selected_piece].pos = current_pos;
-    curr_player->selected_piece = -1;
-    
-    // change player_turn
-    int curr_player_idx = (curr_player == &game->players[PLAYER_ONE]) ? PLAYER_ONE : PLAYER_TWO;
-    curr_player_idx += 1;
-    curr_player_idx %= PLAYER_COUNT;
-    game->current_player = &game->players[curr_player_idx];
+  const char *status = net_lost ? "connection lost" : net_ready ? TextFormat("game %u", net_game_id) : "connecting";
+  DrawText(status, 10, 10, 20, DARKGRAY);
+}
+
+// parses "host" or "host:port"
+bool connect_to_server(const char *address) {
+  char host[256];
+  int port = DEFAULT_PORT;
+  snprintf(host, sizeof(host), "%s", address);
+  char *colon = strrchr(host, ':');
+  if (colon) {
+    *colon = '\0';
+    port = atoi(colon + 1);
   }
+  return net_connect(&net, host, port);
 }
 
-int main() {
-  GameState game = {0};
+int main(int argc, char **argv) {
+  Game game = {0};
   // TODO: learn how to use camera/rotate rectangles
   // look into rlTranslatef
   Camera2D camera = {0};
@@ -333,7 +475,74 @@ int main() {
   camera.offset.x = 400;
   camera.offset.y = 300;
 
-  game_init(&game);
+  game_start(&game);
+  // "red" and/or "black" on the command line hand that side to the computer
+  // "--hash <MB>" sizes the engine's transposition table
+  // "--threads <N>" lets the engine search on N cores
+  // "--egdb <dir>" loads endgame database slices, "egdb" by default
+  // "--book <file>" loads an opening book, "book.ckb" by default
+  // "--nnue <file>" evaluates with a network, "network.nnue" by default
+  // "--connect <host[:port]>" plays a new game on a server, "--join <id>"
+  // joins an existing one, "--seat red|black|both" picks the sides played
+  // here, black for a new game and red for a joined one by default
+  size_t hash_mb = DEFAULT_HASH_MB;
+  const char *egdb_dir = "egdb";
+  const char *book_path = "book.ckb";
+  const char *network_path = "network.nnue";
+  const char *server_address = NULL;
+  uint32_t join_id = 0;
+  bool join = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "red") == 0) {
+      game.state.players[PLAYER_ONE].is_computer = true;
+    } else if (strcmp(argv[i], "black") == 0) {
+      game.state.players[PLAYER_TWO].is_computer = true;
+    } else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+      hash_mb = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      computer_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--egdb") == 0 && i + 1 < argc) {
+      egdb_dir = argv[++i];
+    } else if (strcmp(argv[i], "--book") == 0 && i + 1 < argc) {
+      book_path = argv[++i];
+    } else if (strcmp(argv[i], "--nnue") == 0 && i + 1 < argc) {
+      network_path = argv[++i];
+    } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+      server_address = argv[++i];
+    } else if (strcmp(argv[i], "--join") == 0 && i + 1 < argc) {
+      join_id = strtoul(argv[++i], NULL, 10);
+      join = true;
+    } else if (strcmp(argv[i], "--seat") == 0 && i + 1 < argc) {
+      i++;
+      net_seats = strcmp(argv[i], "red") == 0 ? SEAT_PLAYER_ONE :
+                  strcmp(argv[i], "black") == 0 ? SEAT_PLAYER_TWO : SEAT_PLAYER_ONE | SEAT_PLAYER_TWO;
+    }
+  }
+  if (server_address) {
+    if (!connect_to_server(server_address)) {
+      fprintf(stderr, "could not connect to %s\n", server_address);
+      return 1;
+    }
+    online = true;
+    if (!net_seats) {
+      net_seats = join ? SEAT_PLAYER_ONE : SEAT_PLAYER_TWO;
+    }
+    // queued until the connection is up
+    Message hello = {.type = join ? MSG_JOIN : MSG_NEW_GAME, .game_id = join_id, .seats = net_seats};
+    net_send(&net, &hello);
+  }
+  if (egdb_open(egdb_dir) > 0) {
+    printf("endgame database complete up to %d pieces\n", egdb_max_pieces());
+  }
+  if (book_open(&book, book_path)) {
+    printf("opening book with %llu entries\n", (unsigned long long)book.header->entry_count);
+  }
+  if (nnue_open(&network, network_path)) {
+    printf("evaluating with %s, %s kernels\n", network_path, nnue_kernel());
+  }
+  if (!search_init(hash_mb)) {
+    fprintf(stderr, "could not allocate a %zu MB hash table\n", hash_mb);
+  }
   InitWindow(800, 600, "Checkers");
   int board_size = 500;
   int grid_count = 8;
@@ -345,22 +554,34 @@ int main() {
   Position board_start = (Position) {board_start_x, board_start_y};
   //int current_player_turn = 0;
   while (!WindowShouldClose()) {
+    if (online) {
+      network_update(&game);
+    }
     BeginDrawing();
       ClearBackground((Color) {
         .r=200, .g=200, .b=200, .a=255
       });
-      display_board(game, grid_count, grid_size, board_start);
+      display_board(&game.state, grid_count, grid_size, board_start);
+      draw_result(game.result);
+      draw_network_status();
       // general approach to moving a piece
       // check if user is hovering over a piece
       // then if a user clicks on a piece
       // that piece will be selected to be moved
       Vector2 mouse_pos = GetMousePosition();
-      Player *curr_player = game.current_player;
-      player_select_piece(curr_player, mouse_pos, grid_size, board_start);
-      draw_selected_checker_board(curr_player, grid_size, board_start);
-      player_attempt_move(&game, mouse_pos, grid_size, grid_count, board_start);
+      Player *curr_player = &game.state.players[game.state.current_player];
+      if (!curr_player->is_computer && is_local_turn(&game) && game.result == GAME_ONGOING) {
+        player_select_piece(curr_player, mouse_pos, grid_size, board_start);
+        draw_selected_checker_board(curr_player, grid_size, board_start);
+        player_attempt_move(&game, mouse_pos, grid_size, grid_count, board_start);
+      }
     EndDrawing();
+    computer_update(&game);
   }
+  engine_stop();
   CloseWindow();
+  if (online) {
+    net_close(&net);
+  }
   return 0;
 }
@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include "moves.h"
+#include "zobrist.h"
+
+// men only move forward, kings move along every diagonal
+static const Diagonal player_diagonals[PLAYER_COUNT][2] = {
+  [PLAYER_ONE] = {UP_LEFT, UP_RIGHT},
+  [PLAYER_TWO] = {DOWN_LEFT, DOWN_RIGHT},
+};
+
+typedef struct MoveGen {
+  MoveList *list;
+  Bitboard enemies;
+  Bitboard enemy_kings;
+  Bitboard empty;
+  int side;
+} MoveGen;
+
+static inline void push_move(MoveList *list, const Move *m) {
+  if (list->count < MAX_MOVES) {
+    list->moves[list->count++] = *m;
+  }
+}
+
+// pieces in `pieces` that can jump an enemy along d and land on an empty square
+static inline Bitboard jumpers_along(Bitboard pieces, Bitboard enemies, Bitboard empty, Diagonal d) {
+  Diagonal back = opposite_diagonal(d);
+  return shift_diagonal(shift_diagonal(empty, back) & enemies, back) & pieces;
+}
+
+Bitboard capturing_pieces(const GameState *game) {
+  int side = game->current_player;
+  const Player *own = &game->players[side];
+  Bitboard enemies = player_pieces(&game->players[enemy_of(side)]);
+  Bitboard empty = ~occupied_squares(game);
+  Bitboard result = EMPTY_BOARD;
+  for (int d = 0; d < DIAGONAL_COUNT; d++) {
+    result |= jumpers_along(own->kings, enemies, empty, d);
+  }
+  for (int i = 0; i < 2; i++) {
+    result |= jumpers_along(own->men, enemies, empty, player_diagonals[side][i]);
+  }
+  return result;
+}
+
+Bitboard moving_pieces(const GameState *game) {
+  int side = game->current_player;
+  const Player *own = &game->players[side];
+  Bitboard empty = ~occupied_squares(game);
+  Bitboard result = EMPTY_BOARD;
+  for (int d = 0; d < DIAGONAL_COUNT; d++) {
+    result |= shift_diagonal(empty, opposite_diagonal(d)) & own->kings;
+  }
+  for (int i = 0; i < 2; i++) {
+    result |= shift_diagonal(empty, opposite_diagonal(player_diagonals[side][i])) & own->men;
+  }
+  return result;
+}
+
+// depth first search over every jump sequence starting from sq
+// captured pieces stay on the board until the move is finished,
+// so they can neither be jumped twice nor landed on
+static void add_jumps(MoveGen *gen, Move *m, int sq, bool is_king) {
+  bool extended = false;
+  int dir_count = is_king ? DIAGONAL_COUNT : 2;
+  for (int i = 0; i < dir_count; i++) {
+    Diagonal d = is_king ? (Diagonal)i : player_diagonals[gen->side][i];
+    Bitboard over = shift_diagonal(SQUARE_BIT(sq), d) & gen->enemies & ~m->captured;
+    if (!over) {
+      continue;
+    }
+    Bitboard land = shift_diagonal(over, d) & gen->empty;
+    if (!land) {
+      continue;
+    }
+    int to = __builtin_ctz(land);
+    extended = true;
+    m->captured |= over;
+    m->path[m->jump_count++] = to;
+    if (!is_king && (land & promotion_row(gen->side))) {
+      // a man that gets crowned ends its move
+      m->to = to;
+      m->captured_kings = m->captured & gen->enemy_kings;
+      m->promotes = true;
+      push_move(gen->list, m);
+      m->promotes = false;
+    } else {
+      add_jumps(gen, m, to, is_king);
+    }
+    m->jump_count--;
+    m->captured &= ~over;
+  }
+  if (!extended && m->jump_count > 0) {
+    m->to = sq;
+    m->captured_kings = m->captured & gen->enemy_kings;
+    push_move(gen->list, m);
+  }
+}
+
+static void add_quiet_moves(MoveList *list, Bitboard pieces, Bitboard empty,
+                            Bitboard crowning, Diagonal d) {
+  Bitboard targets = shift_diagonal(pieces, d) & empty;
+  Diagonal back = opposite_diagonal(d);
+  while (targets) {
+    int to = __builtin_ctz(targets);
+    targets &= targets - 1;
+    Move m = {
+      .from = __builtin_ctz(shift_diagonal(SQUARE_BIT(to), back)),
+      .to = to,
+      .promotes = (crowning & SQUARE_BIT(to)) != 0,
+    };
+    push_move(list, &m);
+  }
+}
+
+int generate_moves(const GameState *game, MoveList *list) {
+  list->count = 0;
+  int side = game->current_player;
+  const Player *own = &game->players[side];
+  const Player *enemy = &game->players[enemy_of(side)];
+  MoveGen gen = {
+    .list = list,
+    .enemies = player_pieces(enemy),
+    .enemy_kings = enemy->kings,
+    .empty = ~occupied_squares(game),
+    .side = side,
+  };
+
+  Bitboard jumpers = capturing_pieces(game);
+  if (jumpers) {
+    Bitboard empty = gen.empty;
+    while (jumpers) {
+      int sq = __builtin_ctz(jumpers);
+      jumpers &= jumpers - 1;
+      Move m = {.from = sq};
+      // the moving piece no longer blocks its own starting square
+      gen.empty = empty | SQUARE_BIT(sq);
+      add_jumps(&gen, &m, sq, own->kings & SQUARE_BIT(sq));
+    }
+    return list->count;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    add_quiet_moves(list, own->men, gen.empty, promotion_row(side), player_diagonals[side][i]);
+  }
+  for (int d = 0; d < DIAGONAL_COUNT; d++) {
+    add_quiet_moves(list, own->kings, gen.empty, EMPTY_BOARD, d);
+  }
+  return list->count;
+}
+
+// moving a piece, crowning it and removing captures are all xor toggles,
+// so the same update both plays and takes back a move
+static inline void toggle_move(GameState *game, int side, const Move *m, bool is_king) {
+  Player *own = &game->players[side];
+  Player *enemy = &game->players[enemy_of(side)];
+  Bitboard from = SQUARE_BIT(m->from);
+  Bitboard to = SQUARE_BIT(m->to);
+  uint64_t h = zobrist_side_key;
+  if (m->promotes) {
+    own->men ^= from;
+    own->kings ^= to;
+    h ^= zobrist_piece_keys[side][PAWN][m->from] ^ zobrist_piece_keys[side][KING][m->to];
+  } else if (is_king) {
+    // a king can capture its way round back to where it started
+    own->kings ^= from ^ to;
+    h ^= zobrist_piece_keys[side][KING][m->from] ^ zobrist_piece_keys[side][KING][m->to];
+  } else {
+    own->men ^= from ^ to;
+    h ^= zobrist_piece_keys[side][PAWN][m->from] ^ zobrist_piece_keys[side][PAWN][m->to];
+  }
+  if (m->captured) {
+    Bitboard captured_men = m->captured & ~m->captured_kings;
+    enemy->men ^= captured_men;
+    enemy->kings ^= m->captured_kings;
+    h ^= zobrist_pieces(enemy_of(side), PAWN, captured_men);
+    h ^= zobrist_pieces(enemy_of(side), KING, m->captured_kings);
+  }
+  game->hash ^= h;
+}
+
+void make_move(GameState *game, const Move *m) {
+  int side = game->current_player;
+  toggle_move(game, side, m, game->players[side].kings & SQUARE_BIT(m->from));
+  game->current_player = enemy_of(side);
+}
+
+void unmake_move(GameState *game, const Move *m) {
+  int side = enemy_of(game->current_player);
+  bool is_king = !m->promotes && (game->players[side].kings & SQUARE_BIT(m->to));
+  toggle_move(game, side, m, is_king);
+  game->current_player = side;
+}
+
+void format_move(const Move *m, char *buf, size_t size) {
+  int written = snprintf(buf, size, "%d", square_to_pdn(m->from));
+  if (!is_capture(m)) {
+    if (written < (int)size) {
+      snprintf(buf + written, size - written, "-%d", square_to_pdn(m->to));
+    }
+    return;
+  }
+  for (int i = 0; i < m->jump_count && written < (int)size; i++) {
+    written += snprintf(buf + written, size - written, "x%d", square_to_pdn(m->path[i]));
+  }
+}
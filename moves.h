@@ -0,0 +1,49 @@
+#ifndef MOVES_H
+#define MOVES_H
+
+#include <stddef.h>
+#include "board.h"
+
+// enough for any reachable position, including branching king captures
+#define MAX_MOVES 128
+
+typedef struct Move {
+  Bitboard captured;
+  // the subset of captured that were kings, needed to take the move back
+  Bitboard captured_kings;
+  uint8_t from;
+  uint8_t to;
+  uint8_t jump_count;
+  bool promotes;
+  // landing square of every jump, path[jump_count - 1] == to
+  uint8_t path[MAX_JUMP_COUNT];
+} Move;
+
+typedef struct MoveList {
+  Move moves[MAX_MOVES];
+  int count;
+} MoveList;
+
+// fills list with every legal move for the side to move and returns the count
+// captures are mandatory, so if any exist only captures are generated
+int generate_moves(const GameState *game, MoveList *list);
+
+// pieces of the side to move that have at least one capture available
+Bitboard capturing_pieces(const GameState *game);
+// pieces of the side to move that have a quiet move available
+Bitboard moving_pieces(const GameState *game);
+
+// plays m on game in place, crowning a man that reaches the far row,
+// and passes the turn to the other player
+void make_move(GameState *game, const Move *m);
+// takes back m, which must be the last move made on game
+void unmake_move(GameState *game, const Move *m);
+
+// writes m in PDN notation, e.g. "11-15" or "22x15x6"
+void format_move(const Move *m, char *buf, size_t size);
+
+static inline bool is_capture(const Move *m) {
+  return m->jump_count > 0;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "net.h"
+
+bool net_connect(NetClient *c, const char *host, int port) {
+  memset(c, 0, sizeof(*c));
+  c->fd = -1;
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+  struct addrinfo *addresses;
+  if (getaddrinfo(host, service, &hints, &addresses) != 0) {
+    return false;
+  }
+  for (struct addrinfo *a = addresses; a && c->fd < 0; a = a->ai_next) {
+    int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    int flags = fcntl(fd, F_GETFL, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0 ||
+        (connect(fd, a->ai_addr, a->ai_addrlen) != 0 && errno != EINPROGRESS)) {
+      close(fd);
+      continue;
+    }
+    c->fd = fd;
+  }
+  freeaddrinfo(addresses);
+  return c->fd >= 0;
+}
+
+// a non-blocking connect reports its outcome once the socket is writable
+static bool finish_connect(NetClient *c) {
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+    return false;
+  }
+  struct sockaddr_storage peer;
+  socklen_t peer_length = sizeof(peer);
+  // still in progress while the socket has no peer
+  c->connected = getpeername(c->fd, (struct sockaddr *)&peer, &peer_length) == 0;
+  return true;
+}
+
+bool net_poll(NetClient *c) {
+  if (c->fd < 0) {
+    return false;
+  }
+  if (!c->connected) {
+    if (!finish_connect(c)) {
+      net_close(c);
+      return false;
+    }
+    if (!c->connected) {
+      return true;
+    }
+  }
+  size_t sent = 0;
+  while (sent < c->out_length) {
+    ssize_t n = write(c->fd, c->out + sent, c->out_length - sent);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (n <= 0) {
+      net_close(c);
+      return false;
+    }
+    sent += n;
+  }
+  memmove(c->out, c->out + sent, c->out_length - sent);
+  c->out_length -= sent;
+
+  // messages already handed out make room for new input
+  memmove(c->in, c->in + c->in_used, c->in_length - c->in_used);
+  c->in_length -= c->in_used;
+  c->in_used = 0;
+  while (c->in_length < sizeof(c->in)) {
+    ssize_t n = read(c->fd, c->in + c->in_length, sizeof(c->in) - c->in_length);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (n <= 0) {
+      net_close(c);
+      return false;
+    }
+    c->in_length += n;
+  }
+  return true;
+}
+
+bool net_send(NetClient *c, const Message *m) {
+  if (c->fd < 0) {
+    return false;
+  }
+  size_t length = message_encode(m, c->out + c->out_length, sizeof(c->out) - c->out_length);
+  c->out_length += length;
+  return length > 0;
+}
+
+bool net_receive(NetClient *c, Message *m) {
+  // what arrived before the connection closed is still handed out
+  int length = message_decode(c->in + c->in_used, c->in_length - c->in_used, m);
+  if (length < 0) {
+    net_close(c);
+    c->in_length = c->in_used = 0;
+    return false;
+  }
+  c->in_used += length;
+  return length > 0;
+}
+
+void net_close(NetClient *c) {
+  if (c->fd >= 0) {
+    close(c->fd);
+  }
+  c->fd = -1;
+  c->connected = false;
+}
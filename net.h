@@ -0,0 +1,37 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol.h"
+
+#define NET_BUFFER_SIZE 16384
+
+// a non-blocking connection to a game server, meant to be polled once
+// per frame so a slow network never holds up drawing
+typedef struct NetClient {
+  int fd;
+  // the connect started by net_connect has finished
+  bool connected;
+  uint8_t in[NET_BUFFER_SIZE];
+  size_t in_length;
+  size_t in_used;
+  // messages queued before the connection is up are sent once it is
+  uint8_t out[NET_BUFFER_SIZE];
+  size_t out_length;
+} NetClient;
+
+// starts connecting to host, which may be a name or an address,
+// only the name lookup may block
+bool net_connect(NetClient *c, const char *host, int port);
+// sends what is queued and reads what has arrived without blocking,
+// returns false once the connection is gone
+bool net_poll(NetClient *c);
+// queues m, false when the output buffer is full
+bool net_send(NetClient *c, const Message *m);
+// takes the next complete message read by net_poll, false when there is none
+bool net_receive(NetClient *c, Message *m);
+void net_close(NetClient *c);
+
+#endif
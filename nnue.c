@@ -0,0 +1,265 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "nnue.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define NNUE_AVX2 1
+#endif
+
+// a refresh adds every piece, a move removes its piece and what it captures
+#define MAX_CHANGED_FEATURES (PLAYER_COUNT * PLAYER_CHECKER_COUNT)
+
+// out = in plus the weights of added minus the weights of removed, one accumulator half
+typedef void (*ApplyKernel)(const NnueWeights *w, const int16_t *in, int16_t *out, const int *added,
+                            int added_count, const int *removed, int removed_count);
+// output layer sum from the accumulator half of the side to move and the other one
+typedef int32_t (*ForwardKernel)(const NnueWeights *w, const int16_t *own, const int16_t *enemy);
+
+static ApplyKernel apply_kernel;
+static ForwardKernel forward_kernel;
+static const char *kernel_name;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static inline int clip(int32_t v) {
+  return v < 0 ? 0 : v > NNUE_CLIP ? NNUE_CLIP : v;
+}
+
+static void apply_scalar(const NnueWeights *w, const int16_t *in, int16_t *out, const int *added, int added_count,
+                         const int *removed, int removed_count) {
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    int32_t v = in[i];
+    for (int k = 0; k < added_count; k++) {
+      v += w->feature_weights[added[k]][i];
+    }
+    for (int k = 0; k < removed_count; k++) {
+      v -= w->feature_weights[removed[k]][i];
+    }
+    out[i] = (int16_t)v;
+  }
+}
+
+static int32_t l2_output(const NnueWeights *w, const int32_t *sums) {
+  int32_t output = w->output_bias;
+  for (int j = 0; j < NNUE_L2; j++) {
+    output += clip((sums[j] + w->l2_bias[j]) >> NNUE_L2_SHIFT) * w->output_weights[j];
+  }
+  return output;
+}
+
+static int32_t forward_scalar(const NnueWeights *w, const int16_t *own, const int16_t *enemy) {
+  uint8_t input[2 * NNUE_HIDDEN];
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    input[i] = clip(own[i]);
+    input[NNUE_HIDDEN + i] = clip(enemy[i]);
+  }
+  int32_t sums[NNUE_L2];
+  for (int j = 0; j < NNUE_L2; j++) {
+    int32_t sum = 0;
+    for (int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+      sum += input[i] * w->l2_weights[j][i];
+    }
+    sums[j] = sum;
+  }
+  return l2_output(w, sums);
+}
+
+#ifdef NNUE_AVX2
+// 16 accumulator values per register, each weight row read once
+__attribute__((target("avx2"))) static void apply_avx2(const NnueWeights *w, const int16_t *in, int16_t *out,
+                                                       const int *added, int added_count, const int *removed,
+                                                       int removed_count) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+    for (int k = 0; k < added_count; k++) {
+      v = _mm256_add_epi16(v, _mm256_loadu_si256((const __m256i *)&w->feature_weights[added[k]][i]));
+    }
+    for (int k = 0; k < removed_count; k++) {
+      v = _mm256_sub_epi16(v, _mm256_loadu_si256((const __m256i *)&w->feature_weights[removed[k]][i]));
+    }
+    _mm256_storeu_si256((__m256i *)(out + i), v);
+  }
+}
+
+// clips 32 accumulator values to uint8 activations in their original order
+__attribute__((target("avx2"))) static inline __m256i clipped_bytes(const int16_t *values) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i top = _mm256_set1_epi16(NNUE_CLIP);
+  __m256i low = _mm256_loadu_si256((const __m256i *)values);
+  __m256i high = _mm256_loadu_si256((const __m256i *)(values + 16));
+  low = _mm256_min_epi16(_mm256_max_epi16(low, zero), top);
+  high = _mm256_min_epi16(_mm256_max_epi16(high, zero), top);
+  // packing works within 128 bit halves, the permute puts them back in order
+  return _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xD8);
+}
+
+// uint8 activations times int8 weights, pairs summed to int16 never
+// saturate since both stay within 127 and 128 in size
+__attribute__((target("avx2"))) static int32_t forward_avx2(const NnueWeights *w, const int16_t *own,
+                                                            const int16_t *enemy) {
+  enum { CHUNKS = 2 * NNUE_HIDDEN / 32 };
+  __m256i input[CHUNKS];
+  for (int i = 0; i < CHUNKS / 2; i++) {
+    input[i] = clipped_bytes(own + 32 * i);
+    input[CHUNKS / 2 + i] = clipped_bytes(enemy + 32 * i);
+  }
+  __m256i ones = _mm256_set1_epi16(1);
+  int32_t sums[NNUE_L2];
+  for (int j = 0; j < NNUE_L2; j++) {
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < CHUNKS; i++) {
+      __m256i weights = _mm256_loadu_si256((const __m256i *)&w->l2_weights[j][32 * i]);
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(input[i], weights), ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    sums[j] = _mm_cvtsi128_si32(half);
+  }
+  return l2_output(w, sums);
+}
+#endif
+
+static void set_kernels(bool scalar) {
+#ifdef NNUE_AVX2
+  if (!scalar && __builtin_cpu_supports("avx2")) {
+    apply_kernel = apply_avx2;
+    forward_kernel = forward_avx2;
+    kernel_name = "avx2";
+    return;
+  }
+#endif
+  apply_kernel = apply_scalar;
+  forward_kernel = forward_scalar;
+  kernel_name = "scalar";
+}
+
+static void pick_kernel(void) {
+  set_kernels(false);
+}
+
+void nnue_use_scalar(bool scalar) {
+  pthread_once(&kernel_once, pick_kernel);
+  set_kernels(scalar);
+}
+
+const char *nnue_kernel(void) {
+  pthread_once(&kernel_once, pick_kernel);
+  return kernel_name;
+}
+
+bool nnue_write(const char *path, const NnueWeights *weights) {
+  char tmp_path[512];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f) {
+    return false;
+  }
+  NnueHeader header = {
+    .magic = NNUE_MAGIC,
+    .version = NNUE_VERSION,
+    .features = NNUE_FEATURES,
+    .hidden = NNUE_HIDDEN,
+    .l2 = NNUE_L2,
+    .weights_bytes = sizeof(NnueWeights),
+  };
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(weights, sizeof(NnueWeights), 1, f) == 1;
+  ok = (fclose(f) == 0) && ok;
+  return ok && rename(tmp_path, path) == 0;
+}
+
+bool nnue_open(NnueNetwork *net, const char *path) {
+  memset(net, 0, sizeof(*net));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(NnueHeader) + sizeof(NnueWeights)) {
+    close(fd);
+    return false;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  const NnueHeader *header = map;
+  // a network of another shape cannot be read into this one
+  if (header->magic != NNUE_MAGIC || header->version != NNUE_VERSION || header->features != NNUE_FEATURES ||
+      header->hidden != NNUE_HIDDEN || header->l2 != NNUE_L2 || header->weights_bytes != sizeof(NnueWeights)) {
+    fprintf(stderr, "%s is not a network this build can use\n", path);
+    munmap(map, st.st_size);
+    return false;
+  }
+  net->header = header;
+  net->weights = (const NnueWeights *)(header + 1);
+  net->map_length = st.st_size;
+  return true;
+}
+
+void nnue_close(NnueNetwork *net) {
+  if (net->header) {
+    munmap((void *)net->header, net->map_length);
+  }
+  memset(net, 0, sizeof(*net));
+}
+
+// input of a piece of owner on sq as view sees it
+static inline int feature_index(int view, int owner, bool king, int sq) {
+  int square = player_direction(view) == UP ? sq : SQUARE_COUNT - 1 - sq;
+  return ((owner == view ? 0 : 2) + king) * SQUARE_COUNT + square;
+}
+
+void nnue_refresh(const NnueNetwork *net, const GameState *game, NnueAccumulator *acc) {
+  pthread_once(&kernel_once, pick_kernel);
+  for (int view = 0; view < PLAYER_COUNT; view++) {
+    int added[MAX_CHANGED_FEATURES];
+    int count = 0;
+    for (int owner = 0; owner < PLAYER_COUNT; owner++) {
+      const Player *p = &game->players[owner];
+      for (Bitboard b = player_pieces(p); b; b &= b - 1) {
+        int sq = __builtin_ctz(b);
+        added[count++] = feature_index(view, owner, (p->kings & SQUARE_BIT(sq)) != 0, sq);
+      }
+    }
+    apply_kernel(net->weights, net->weights->feature_bias, acc->values[view], added, count, NULL, 0);
+  }
+}
+
+void nnue_update(const NnueNetwork *net, const GameState *game, const Move *m, const NnueAccumulator *before,
+                 NnueAccumulator *acc) {
+  pthread_once(&kernel_once, pick_kernel);
+  int mover = game->current_player;
+  int other = enemy_of(mover);
+  bool was_king = (game->players[mover].kings & SQUARE_BIT(m->from)) != 0;
+  for (int view = 0; view < PLAYER_COUNT; view++) {
+    int added = feature_index(view, mover, was_king || m->promotes, m->to);
+    int removed[MAX_CHANGED_FEATURES];
+    int count = 0;
+    removed[count++] = feature_index(view, mover, was_king, m->from);
+    for (Bitboard b = m->captured; b; b &= b - 1) {
+      int sq = __builtin_ctz(b);
+      removed[count++] = feature_index(view, other, (m->captured_kings & SQUARE_BIT(sq)) != 0, sq);
+    }
+    apply_kernel(net->weights, before->values[view], acc->values[view], &added, 1, removed, count);
+  }
+}
+
+int nnue_evaluate(const NnueNetwork *net, const GameState *game, const NnueAccumulator *acc) {
+  pthread_once(&kernel_once, pick_kernel);
+  int side = game->current_player;
+  return forward_kernel(net->weights, acc->values[side], acc->values[enemy_of(side)]) / NNUE_OUTPUT_SCALE;
+}
+
+int nnue_evaluate_position(const NnueNetwork *net, const GameState *game) {
+  NnueAccumulator acc;
+  nnue_refresh(net, game, &acc);
+  return nnue_evaluate(net, game, &acc);
+}
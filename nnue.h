@@ -0,0 +1,85 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+#include "moves.h"
+
+#define NNUE_MAGIC 0x4E4E4B43 // "CKNN"
+#define NNUE_VERSION 1
+
+// one input per piece kind and square, seen from one player with its own
+// men moving up: own men, own kings, enemy men, enemy kings
+#define NNUE_FEATURES (4 * SQUARE_COUNT)
+// accumulator width per player, the first layer
+#define NNUE_HIDDEN 256
+// second layer, fed both accumulators with the side to move first
+#define NNUE_L2 32
+// activations are clipped to 0..NNUE_CLIP so they fit a uint8
+#define NNUE_CLIP 127
+// the second layer sums are scaled back to activations by this shift
+#define NNUE_L2_SHIFT 6
+// the output sum divided by this is the score, MAN_VALUE to a man
+#define NNUE_OUTPUT_SCALE 16
+
+// header of a network file, followed by one NnueWeights exactly as it
+// sits in memory, so the file is mapped and used without parsing
+typedef struct NnueHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t features;
+  uint32_t hidden;
+  uint32_t l2;
+  uint32_t weights_bytes;
+  uint8_t pad[40];
+} NnueHeader;
+
+// every array starts on a 32 byte boundary of the mapped file
+typedef struct NnueWeights {
+  int16_t feature_bias[NNUE_HIDDEN];
+  int16_t feature_weights[NNUE_FEATURES][NNUE_HIDDEN];
+  int32_t l2_bias[NNUE_L2];
+  int8_t l2_weights[NNUE_L2][2 * NNUE_HIDDEN];
+  int8_t output_weights[NNUE_L2];
+  int32_t output_bias;
+  uint8_t pad[28];
+} NnueWeights;
+
+typedef struct NnueNetwork {
+  const NnueHeader *header;
+  const NnueWeights *weights;
+  size_t map_length;
+} NnueNetwork;
+
+// first layer sums of one position, indexed by the player whose view
+// they are, kept per ply and updated move by move
+typedef struct NnueAccumulator {
+  int16_t values[PLAYER_COUNT][NNUE_HIDDEN];
+} NnueAccumulator;
+
+// writes a network file, through a temporary so a reader never maps half of one
+bool nnue_write(const char *path, const NnueWeights *weights);
+// maps a network file read only, false when missing or malformed
+bool nnue_open(NnueNetwork *net, const char *path);
+void nnue_close(NnueNetwork *net);
+
+// computes acc for game from scratch
+void nnue_refresh(const NnueNetwork *net, const GameState *game, NnueAccumulator *acc);
+// acc of game once m is played, from before, the acc of game, touching
+// only the inputs of the squares m changes, game is left as it is
+void nnue_update(const NnueNetwork *net, const GameState *game, const Move *m, const NnueAccumulator *before,
+                 NnueAccumulator *acc);
+// score of game from the point of view of the side to move, like
+// evaluate, given acc is up to date for game
+int nnue_evaluate(const NnueNetwork *net, const GameState *game, const NnueAccumulator *acc);
+// refresh and evaluate in one, for callers that do not keep an accumulator
+int nnue_evaluate_position(const NnueNetwork *net, const GameState *game);
+
+// which kernels run on this machine, for benchmarks
+const char *nnue_kernel(void);
+// forces the portable kernels, to check the vector ones against, for the
+// benchmark only since it must not run while anything is evaluating
+void nnue_use_scalar(bool scalar);
+
+#endif
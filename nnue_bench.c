@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "moves.h"
+#include "eval.h"
+#include "nnue.h"
+#include "timeman.h"
+
+#define DEFAULT_POSITIONS 200000
+#define RANDOM_NETWORK "random.nnue"
+
+// one step of a random game, before is the position move is played in,
+// a new game starts wherever restart is set
+typedef struct Step {
+  GameState before;
+  Move move;
+  bool restart;
+} Step;
+
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+static void random_steps(Step *steps, int count) {
+  uint64_t random = 0x9E3779B97F4A7C15ULL;
+  GameState game;
+  game_init(&game);
+  bool restart = true;
+  for (int i = 0; i < count; i++) {
+    MoveList moves;
+    int move_count = generate_moves(&game, &moves);
+    if (move_count == 0) {
+      game_init(&game);
+      move_count = generate_moves(&game, &moves);
+      restart = true;
+    }
+    steps[i].before = game;
+    steps[i].move = moves.moves[next_random(&random) % move_count];
+    steps[i].restart = restart;
+    make_move(&game, &steps[i].move);
+    restart = false;
+  }
+}
+
+// weights small enough that the accumulators stay well inside int16,
+// a stand in for a trained network when timing and checking the kernels
+static bool write_random_network(const char *path) {
+  NnueWeights *w = calloc(1, sizeof(NnueWeights));
+  uint64_t random = 0x2545F4914F6CDD1DULL;
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    w->feature_bias[i] = (int16_t)(next_random(&random) % 64);
+    for (int f = 0; f < NNUE_FEATURES; f++) {
+      w->feature_weights[f][i] = (int16_t)(next_random(&random) % 33) - 16;
+    }
+  }
+  for (int j = 0; j < NNUE_L2; j++) {
+    w->l2_bias[j] = (int32_t)(next_random(&random) % 4096);
+    for (int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+      w->l2_weights[j][i] = (int8_t)(next_random(&random) % 255 - 127);
+    }
+    w->output_weights[j] = (int8_t)(next_random(&random) % 255 - 127);
+  }
+  bool ok = nnue_write(path, w);
+  free(w);
+  return ok;
+}
+
+// scores every step's position once played, refreshing each from scratch
+// or updating from the previous one
+static double time_scores(const NnueNetwork *net, const Step *steps, int count, bool incremental, int *scores) {
+  NnueAccumulator acc[2];
+  double start = now_seconds();
+  for (int i = 0; i < count; i++) {
+    GameState after = steps[i].before;
+    make_move(&after, &steps[i].move);
+    NnueAccumulator *next = &acc[(i + 1) & 1];
+    if (!incremental) {
+      nnue_refresh(net, &after, next);
+    } else {
+      NnueAccumulator *prev = &acc[i & 1];
+      if (steps[i].restart) {
+        nnue_refresh(net, &steps[i].before, prev);
+      }
+      nnue_update(net, &steps[i].before, &steps[i].move, prev, next);
+    }
+    scores[i] = nnue_evaluate(net, &after, next);
+  }
+  return now_seconds() - start;
+}
+
+// nnue_bench [network.nnue] [positions]
+// checks incremental updates against refreshes and the vector kernels
+// against the scalar ones, and times each, on a random network without a file
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : NULL;
+  int count = argc > 2 ? atoi(argv[2]) : DEFAULT_POSITIONS;
+  if (count < 1) {
+    fprintf(stderr, "usage: %s [network.nnue] [positions]\n", argv[0]);
+    return 2;
+  }
+  if (!path) {
+    path = RANDOM_NETWORK;
+    if (!write_random_network(path)) {
+      fprintf(stderr, "could not write %s\n", path);
+      return 1;
+    }
+  }
+  NnueNetwork net;
+  if (!nnue_open(&net, path)) {
+    fprintf(stderr, "could not open %s\n", path);
+    return 1;
+  }
+  Step *steps = malloc(count * sizeof(Step));
+  int *reference = malloc(count * sizeof(int));
+  int *scores = malloc(count * sizeof(int));
+  random_steps(steps, count);
+
+  double start = now_seconds();
+  for (int i = 0; i < count; i++) {
+    GameState after = steps[i].before;
+    make_move(&after, &steps[i].move);
+    reference[i] = evaluate(&after);
+  }
+  double static_time = now_seconds() - start;
+  printf("%d positions, network %s\n", count, path);
+  printf("static eval:        %6.2f Mpositions/s\n", count / static_time / 1e6);
+
+  int failures = 0;
+  nnue_use_scalar(true);
+  time_scores(&net, steps, count, false, reference);
+  for (int scalar = 1; scalar >= 0; scalar--) {
+    nnue_use_scalar(scalar);
+    for (int incremental = 0; incremental <= 1; incremental++) {
+      double seconds = time_scores(&net, steps, count, incremental, scores);
+      int mismatches = 0;
+      for (int i = 0; i < count; i++) {
+        mismatches += scores[i] != reference[i];
+      }
+      printf("%-6s %-11s %6.2f Mpositions/s, %.1f ns each%s\n", nnue_kernel(),
+             incremental ? "incremental" : "refresh", count / seconds / 1e6, seconds / count * 1e9,
+             mismatches ? ", MISMATCH" : "");
+      failures += mismatches;
+    }
+  }
+  nnue_close(&net);
+  free(steps);
+  free(reference);
+  free(scores);
+  if (failures) {
+    printf("%d scores differ from the scalar refresh\n", failures);
+    return 1;
+  }
+  printf("every kernel and update path agrees\n");
+  return 0;
+}
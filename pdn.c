@@ -0,0 +1,499 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pdn.h"
+
+#define MAX_PDN_THREADS 64
+
+// a move as written: its squares in PDN numbering, in order
+typedef struct PdnMove {
+  int squares[MAX_JUMP_COUNT + 1];
+  int count;
+} PdnMove;
+
+static inline bool is_space(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// characters that end a movetext token without being part of it
+static inline bool ends_token(char c) {
+  return is_space(c) || c == '{' || c == '(' || c == ')' || c == '[' || c == ';';
+}
+
+static bool span_is(const char *text, size_t length, const char *literal) {
+  return strlen(literal) == length && memcmp(text, literal, length) == 0;
+}
+
+static const char *skip_space(const char *p, const char *end) {
+  while (p < end && is_space(*p)) {
+    p++;
+  }
+  return p;
+}
+
+static const char *skip_past(const char *p, const char *end, char c) {
+  const void *found = memchr(p, c, end - p);
+  return found ? (const char *)found + 1 : end;
+}
+
+// variations can nest, none of their moves are played
+static const char *skip_variation(const char *p, const char *end) {
+  int depth = 0;
+  for (; p < end; p++) {
+    if (*p == '{') {
+      p = skip_past(p, end, '}') - 1;
+    } else if (*p == '(') {
+      depth++;
+    } else if (*p == ')' && --depth == 0) {
+      return p + 1;
+    }
+  }
+  return end;
+}
+
+// checkers PDN also writes results as scores out of 2
+static bool parse_result(const char *text, size_t length, GameResult *result) {
+  if (span_is(text, length, "1-0") || span_is(text, length, "2-0")) {
+    *result = GAME_PLAYER_TWO_WINS;
+  } else if (span_is(text, length, "0-1") || span_is(text, length, "0-2")) {
+    *result = GAME_PLAYER_ONE_WINS;
+  } else if (span_is(text, length, "1/2-1/2") || span_is(text, length, "1-1")) {
+    *result = GAME_DRAW;
+  } else if (span_is(text, length, "*")) {
+    *result = GAME_ONGOING;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// reads "11-15", "22x15x6" or "1.11-15" style tokens, a bare move
+// number such as "12." or "12..." gives a move with no squares
+static bool parse_move(const char *p, const char *end, PdnMove *move) {
+  move->count = 0;
+  while (p < end) {
+    int n = 0;
+    const char *digits = p;
+    while (p < end && is_digit(*p) && p - digits < 4) {
+      n = n * 10 + (*p++ - '0');
+    }
+    if (p == digits) {
+      break;
+    }
+    if (move->count == 0 && p < end && *p == '.') {
+      while (p < end && *p == '.') {
+        p++;
+      }
+      continue;
+    }
+    if (n < 1 || n > SQUARE_COUNT || move->count > MAX_JUMP_COUNT) {
+      return false;
+    }
+    move->squares[move->count++] = square_from_pdn(n);
+    if (p < end && (*p == '-' || *p == 'x' || *p == ':')) {
+      p++;
+    } else {
+      break;
+    }
+  }
+  // annotations such as "!" or "?!" may follow a move
+  while (p < end && (*p == '!' || *p == '?')) {
+    p++;
+  }
+  return p == end && move->count != 1;
+}
+
+// whether m lands on the written squares in order, when some in between
+// are left out it only needs to pass through the others
+static bool follows_path(const Move *m, const PdnMove *move, bool complete) {
+  if (m->from != move->squares[0] || m->to != move->squares[move->count - 1] ||
+      (complete && is_capture(m) && m->jump_count != move->count - 1)) {
+    return false;
+  }
+  int next = 1;
+  for (int j = 0; j < m->jump_count - 1 && next < move->count - 1; j++) {
+    if (m->path[j] == move->squares[next]) {
+      next++;
+    }
+  }
+  return next == move->count - 1;
+}
+
+// the legal move the written squares describe, a king can reach the same
+// square over a longer path, so one that lands on exactly the written
+// squares wins over one that only passes through them
+static const Move *match_move(const MoveList *moves, const PdnMove *move) {
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < moves->count; i++) {
+      if (follows_path(&moves->moves[i], move, pass == 0)) {
+        return &moves->moves[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+static void invalidate(PdnGame *game, const char *error) {
+  if (game->valid) {
+    game->valid = false;
+    game->error = error;
+  }
+}
+
+static void read_fen(PdnGame *game) {
+  char fen[PDN_MAX_FEN];
+  size_t length = game->fen.length;
+  // some writers end the position with a period
+  while (length > 0 && (game->fen.text[length - 1] == '.' || is_space(game->fen.text[length - 1]))) {
+    length--;
+  }
+  if (length >= sizeof(fen)) {
+    invalidate(game, "FEN tag too long");
+    return;
+  }
+  memcpy(fen, game->fen.text, length);
+  fen[length] = '\0';
+  if (!game_set_fen(&game->start, fen)) {
+    invalidate(game, "malformed FEN tag");
+  }
+}
+
+// reads one [Name "value"] tag starting at its '['
+static const char *parse_tag(const char *p, const char *end, PdnGame *game, GameResult *tag_result) {
+  const char *name = ++p;
+  while (p < end && !is_space(*p) && *p != '"' && *p != ']') {
+    p++;
+  }
+  size_t name_length = p - name;
+  p = skip_space(p, end);
+  if (p == end || *p != '"') {
+    invalidate(game, "malformed tag");
+    return skip_past(p, end, ']');
+  }
+  const char *value = ++p;
+  while (p < end && *p != '"') {
+    // a backslash escapes the next character
+    p += (*p == '\\' && p + 1 < end) ? 2 : 1;
+  }
+  PdnSpan span = {value, (p < end ? p : end) - value};
+  p = skip_past(p, end, ']');
+  if (span_is(name, name_length, "Event")) {
+    game->event = span;
+  } else if (span_is(name, name_length, "Black")) {
+    game->black = span;
+  } else if (span_is(name, name_length, "White")) {
+    game->white = span;
+  } else if (span_is(name, name_length, "FEN")) {
+    game->fen = span;
+  } else if (span_is(name, name_length, "Result")) {
+    parse_result(span.text, span.length, tag_result);
+  } else if (span_is(name, name_length, "GameType")) {
+    // 21 is English draughts, anything else plays by other rules
+    if (span.length < 2 || memcmp(span.text, "21", 2) != 0 ||
+        (span.length > 2 && span.text[2] != ',')) {
+      invalidate(game, "not an English draughts game");
+    }
+  }
+  return p;
+}
+
+// plays the movetext up to its result token, or the next game's tags
+static const char *parse_movetext(const char *p, const char *end, PdnGame *game, const PdnHandlers *h) {
+  GameState *position = &game->position;
+  while (p < end) {
+    char c = *p;
+    if (is_space(c) || c == ')') {
+      p++;
+      continue;
+    }
+    if (c == '[') {
+      return p;
+    }
+    if (c == '{') {
+      p = skip_past(p, end, '}');
+      continue;
+    }
+    if (c == ';') {
+      p = skip_past(p, end, '\n');
+      continue;
+    }
+    if (c == '(') {
+      p = skip_variation(p, end);
+      continue;
+    }
+    const char *token = p;
+    while (p < end && !ends_token(*p)) {
+      p++;
+    }
+    if (c == '$') {
+      continue;
+    }
+    GameResult result;
+    if (parse_result(token, p - token, &result)) {
+      game->result = result;
+      return p;
+    }
+    if (!game->valid) {
+      continue;
+    }
+    PdnMove written;
+    if (!parse_move(token, p, &written)) {
+      invalidate(game, "unreadable move");
+      continue;
+    }
+    if (written.count == 0) {
+      continue;
+    }
+    MoveList moves;
+    generate_moves(position, &moves);
+    const Move *m = match_move(&moves, &written);
+    if (!m) {
+      invalidate(game, "illegal move");
+      continue;
+    }
+    make_move(position, m);
+    if (h && h->on_move) {
+      h->on_move(h->user, game, game->ply_count, m, position);
+    }
+    game->ply_count++;
+  }
+  return p;
+}
+
+void pdn_parse(const char *text, size_t length, const PdnHandlers *h, PdnStats *stats) {
+  const char *p = text;
+  const char *end = text + length;
+  PdnStats local = {0};
+  while ((p = skip_space(p, end)) < end) {
+    PdnGame game;
+    memset(&game, 0, sizeof(game));
+    game.offset = p - text;
+    game.valid = true;
+    GameResult tag_result = GAME_ONGOING;
+    while (p < end && *p == '[') {
+      p = skip_space(parse_tag(p, end, &game, &tag_result), end);
+    }
+    game_init(&game.start);
+    if (game.fen.text) {
+      read_fen(&game);
+    }
+    game.position = game.start;
+    p = parse_movetext(p, end, &game, h);
+    if (game.result == GAME_ONGOING) {
+      game.result = tag_result;
+    }
+    local.games++;
+    local.invalid_games += !game.valid;
+    local.plies += game.ply_count;
+    if (h && h->on_game) {
+      h->on_game(h->user, &game);
+    }
+  }
+  stats->games += local.games;
+  stats->invalid_games += local.invalid_games;
+  stats->plies += local.plies;
+}
+
+// the start of the first game at or after offset: a '[' opening a line
+// whose previous text does not end in another tag
+static size_t next_game_start(const char *text, size_t length, size_t offset) {
+  for (size_t i = offset; i > 0 && i < length; i++) {
+    if (text[i] != '[' || text[i - 1] != '\n') {
+      continue;
+    }
+    size_t j = i - 1;
+    while (j > 0 && is_space(text[j])) {
+      j--;
+    }
+    if (text[j] != ']') {
+      return i;
+    }
+  }
+  return offset == 0 ? 0 : length;
+}
+
+typedef struct PdnChunk {
+  const char *text;
+  size_t length;
+  const PdnHandlers *handlers;
+  PdnStats stats;
+} PdnChunk;
+
+static void *parse_chunk(void *arg) {
+  PdnChunk *chunk = arg;
+  pdn_parse(chunk->text, chunk->length, chunk->handlers, &chunk->stats);
+  return NULL;
+}
+
+bool pdn_parse_file(const char *path, int threads, const PdnHandlers *h, PdnStats *stats) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  size_t length = st.st_size;
+  if (length == 0) {
+    close(fd);
+    return true;
+  }
+  const char *text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == MAP_FAILED) {
+    return false;
+  }
+  posix_madvise((void *)text, length, POSIX_MADV_SEQUENTIAL);
+  // set up the zobrist keys before any thread needs them
+  GameState initial;
+  game_init(&initial);
+
+  if (threads < 1) {
+    threads = 1;
+  }
+  if (threads > MAX_PDN_THREADS) {
+    threads = MAX_PDN_THREADS;
+  }
+  PdnChunk chunks[MAX_PDN_THREADS];
+  pthread_t ids[MAX_PDN_THREADS];
+  size_t start = 0;
+  for (int i = 0; i < threads; i++) {
+    size_t stop = i == threads - 1 ? length : next_game_start(text, length, length / threads * (i + 1));
+    if (stop < start) {
+      stop = start;
+    }
+    chunks[i] = (PdnChunk){text + start, stop - start, h, {0}};
+    start = stop;
+  }
+  int started = 1;
+  for (; started < threads; started++) {
+    if (pthread_create(&ids[started], NULL, parse_chunk, &chunks[started]) != 0) {
+      break;
+    }
+  }
+  // chunks that did not get a thread are parsed here
+  parse_chunk(&chunks[0]);
+  for (int i = started; i < threads; i++) {
+    parse_chunk(&chunks[i]);
+  }
+  for (int i = 0; i < threads; i++) {
+    if (i > 0 && i < started) {
+      pthread_join(ids[i], NULL);
+    }
+    stats->games += chunks[i].stats.games;
+    stats->invalid_games += chunks[i].stats.invalid_games;
+    stats->plies += chunks[i].stats.plies;
+  }
+  munmap((void *)text, length);
+  return true;
+}
+
+void pdn_writer_init(PdnWriter *w, FILE *file) {
+  memset(w, 0, sizeof(*w));
+  w->file = file;
+}
+
+static void write_tag(PdnWriter *w, const char *name, const char *value) {
+  fprintf(w->file, "[%s \"", name);
+  for (const char *s = value; *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      fputc('\\', w->file);
+    }
+    fputc(*s, w->file);
+  }
+  fputs("\"]\n", w->file);
+}
+
+static const char *result_token(GameResult result) {
+  static const char *tokens[] = {"*", "0-1", "1-0", "1/2-1/2"};
+  return tokens[result];
+}
+
+// adds one movetext word, wrapping the line first when it would not fit
+static void write_word(PdnWriter *w, const char *word) {
+  int length = strlen(word);
+  if (w->column > 0 && w->column + 1 + length > PDN_LINE_LENGTH) {
+    fputc('\n', w->file);
+    w->column = 0;
+  } else if (w->column > 0) {
+    fputc(' ', w->file);
+    w->column++;
+  }
+  fputs(word, w->file);
+  w->column += length;
+}
+
+void pdn_begin_game(PdnWriter *w, const PdnTags *tags, const GameState *start, GameResult result) {
+  if (start) {
+    w->position = *start;
+  } else {
+    game_init(&w->position);
+  }
+  w->ply = 0;
+  w->white_started = w->position.current_player == PLAYER_ONE;
+  w->column = 0;
+  w->result = result;
+  if (tags && tags->event) {
+    write_tag(w, "Event", tags->event);
+  }
+  if (tags && tags->black) {
+    write_tag(w, "Black", tags->black);
+  }
+  if (tags && tags->white) {
+    write_tag(w, "White", tags->white);
+  }
+  write_tag(w, "Result", result_token(result));
+  if (!is_initial_position(&w->position)) {
+    char fen[PDN_MAX_FEN];
+    game_format_fen(&w->position, fen, sizeof(fen));
+    write_tag(w, "FEN", fen);
+  }
+}
+
+bool pdn_write_move(PdnWriter *w, const Move *m) {
+  MoveList moves;
+  generate_moves(&w->position, &moves);
+  const Move *legal = NULL;
+  for (int i = 0; i < moves.count && !legal; i++) {
+    const Move *candidate = &moves.moves[i];
+    if (candidate->from == m->from && candidate->to == m->to && candidate->captured == m->captured) {
+      legal = candidate;
+    }
+  }
+  if (!legal) {
+    return false;
+  }
+  char word[16 + 4 * (MAX_JUMP_COUNT + 1)];
+  int written = 0;
+  // black moves first, so a game that starts with white to move
+  // opens with "1..." and black's moves carry the numbers
+  bool white = w->position.current_player == PLAYER_ONE;
+  int turn = (w->ply + w->white_started) / 2 + 1;
+  if (!white) {
+    written = snprintf(word, sizeof(word), "%d. ", turn);
+  } else if (w->ply == 0) {
+    written = snprintf(word, sizeof(word), "%d... ", turn);
+  }
+  format_move(legal, word + written, sizeof(word) - written);
+  write_word(w, word);
+  make_move(&w->position, legal);
+  w->ply++;
+  return true;
+}
+
+bool pdn_end_game(PdnWriter *w) {
+  write_word(w, result_token(w->result));
+  fputs("\n\n", w->file);
+  w->games++;
+  return !ferror(w->file);
+}
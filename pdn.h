@@ -0,0 +1,95 @@
+#ifndef PDN_H
+#define PDN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+
+// longest FEN tag value a game may carry, anything longer is invalid
+#define PDN_MAX_FEN 256
+// the writer wraps movetext before this many columns
+#define PDN_LINE_LENGTH 79
+
+// a piece of the input text, not null terminated
+typedef struct PdnSpan {
+  const char *text;
+  size_t length;
+} PdnSpan;
+
+// one game as the reader sees it, tag values point into the input
+// "1-0" is a win for black, who moves first, as in every checkers PDN
+typedef struct PdnGame {
+  PdnSpan event;
+  PdnSpan black;
+  PdnSpan white;
+  PdnSpan fen;
+  // byte offset of the game's first tag or move in the input
+  size_t offset;
+  GameState start;
+  // the position after the moves played so far
+  GameState position;
+  int ply_count;
+  // the movetext's result token, the Result tag when there is none
+  GameResult result;
+  // cleared on the first move that is not legal, the rest of the game
+  // is skipped and error says why
+  bool valid;
+  const char *error;
+} PdnGame;
+
+// position is the state after m, the ply'th move of game
+// with more than one thread the callbacks run on several at once
+typedef void (*PdnMoveCallback)(void *user, const PdnGame *game, int ply, const Move *m,
+                                const GameState *position);
+// called once a game's movetext ends, whether it was valid or not
+typedef void (*PdnGameCallback)(void *user, const PdnGame *game);
+
+typedef struct PdnHandlers {
+  PdnMoveCallback on_move;
+  PdnGameCallback on_game;
+  void *user;
+} PdnHandlers;
+
+typedef struct PdnStats {
+  uint64_t games;
+  uint64_t invalid_games;
+  uint64_t plies;
+} PdnStats;
+
+// parses every game in text[0, length), either handler may be NULL
+void pdn_parse(const char *text, size_t length, const PdnHandlers *h, PdnStats *stats);
+// maps path into memory and parses it, split into up to threads chunks
+// at game boundaries that are parsed at the same time
+bool pdn_parse_file(const char *path, int threads, const PdnHandlers *h, PdnStats *stats);
+
+// optional tags of a game being written, NULL leaves a tag out
+typedef struct PdnTags {
+  const char *event;
+  const char *black;
+  const char *white;
+} PdnTags;
+
+typedef struct PdnWriter {
+  FILE *file;
+  GameState position;
+  int ply;
+  bool white_started;
+  // movetext columns used on the current line
+  int column;
+  GameResult result;
+  uint64_t games;
+} PdnWriter;
+
+void pdn_writer_init(PdnWriter *w, FILE *file);
+// writes the tags, with a FEN tag when start is not the initial
+// position, start NULL means the initial position
+void pdn_begin_game(PdnWriter *w, const PdnTags *tags, const GameState *start, GameResult result);
+// m must be legal in the position reached so far, returns false otherwise
+bool pdn_write_move(PdnWriter *w, const Move *m);
+// writes the result token and the blank line that ends a game
+bool pdn_end_game(PdnWriter *w);
+
+#endif
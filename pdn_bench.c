@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+#include "pdn.h"
+#include "timeman.h"
+
+#define DEFAULT_GAMES 200000
+#define DEFAULT_FILE "games.pdn"
+// every this many games start from a few random moves in, so FEN tags
+// and games that open with white to move are covered too
+#define CUSTOM_START_EVERY 10
+#define CUSTOM_START_PLIES 7
+
+// what every parse of the file has to add up to
+typedef struct Totals {
+  uint64_t games;
+  uint64_t plies;
+  uint64_t results[GAME_DRAW + 1];
+  // sum of the final positions' hashes, the same in any game order
+  uint64_t hash_sum;
+} Totals;
+
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+// random games played to the end under the draw rules, written the way
+// a game database would hold them
+static bool write_games(const char *path, int game_count, Totals *totals) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    return false;
+  }
+  uint64_t random = 0x9E3779B97F4A7C15ULL;
+  static Game game;
+  static Move moves_played[MAX_GAME_PLIES];
+  PdnWriter w;
+  pdn_writer_init(&w, f);
+  for (int g = 0; g < game_count; g++) {
+    game_start(&game);
+    if (g % CUSTOM_START_EVERY == CUSTOM_START_EVERY - 1) {
+      for (int i = 0; i < CUSTOM_START_PLIES && game.result == GAME_ONGOING; i++) {
+        MoveList moves;
+        int count = generate_moves(&game.state, &moves);
+        game_play(&game, &moves.moves[next_random(&random) % count]);
+      }
+      GameState start = game.state;
+      game_resume(&game, &start, 0);
+    }
+    GameState start = game.state;
+    while (game.result == GAME_ONGOING) {
+      MoveList moves;
+      int count = generate_moves(&game.state, &moves);
+      moves_played[game.ply] = moves.moves[next_random(&random) % count];
+      game_play(&game, &moves_played[game.ply]);
+    }
+    char event[32];
+    snprintf(event, sizeof(event), "random game %d", g + 1);
+    PdnTags tags = {.event = event, .black = "random", .white = "random"};
+    pdn_begin_game(&w, &tags, &start, game.result);
+    for (int i = 0; i < game.ply; i++) {
+      if (!pdn_write_move(&w, &moves_played[i])) {
+        fclose(f);
+        return false;
+      }
+    }
+    pdn_end_game(&w);
+    totals->games++;
+    totals->plies += game.ply;
+    totals->results[game.result]++;
+    totals->hash_sum += game.state.hash;
+  }
+  return fclose(f) == 0;
+}
+
+static void count_game(void *user, const PdnGame *game) {
+  Totals *totals = user;
+  __atomic_add_fetch(&totals->games, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&totals->results[game->result], 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&totals->hash_sum, game->position.hash, __ATOMIC_RELAXED);
+}
+
+static bool parse_and_report(const char *path, int threads, const Totals *expected) {
+  Totals totals = {0};
+  PdnStats stats = {0};
+  PdnHandlers handlers = {.on_game = count_game, .user = &totals};
+  double start = now_seconds();
+  if (!pdn_parse_file(path, threads, &handlers, &stats)) {
+    fprintf(stderr, "could not read %s\n", path);
+    return false;
+  }
+  double elapsed = now_seconds() - start;
+  FILE *f = fopen(path, "rb");
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fclose(f);
+  printf("%2d thread%s: %llu games, %llu plies, %llu invalid, %.3f s, %.0f games/min, %.1f Mplies/s, %.0f MB/s\n",
+         threads, threads == 1 ? " " : "s", (unsigned long long)stats.games,
+         (unsigned long long)stats.plies, (unsigned long long)stats.invalid_games, elapsed,
+         stats.games / elapsed * 60, stats.plies / elapsed / 1e6, size / elapsed / 1e6);
+  if (!expected) {
+    return true;
+  }
+  bool same = stats.games == expected->games && stats.plies == expected->plies &&
+              stats.invalid_games == 0 && totals.hash_sum == expected->hash_sum;
+  for (int r = GAME_ONGOING; r <= GAME_DRAW; r++) {
+    same = same && totals.results[r] == expected->results[r];
+  }
+  if (!same) {
+    fprintf(stderr, "parsed games do not match the ones written\n");
+  }
+  return same;
+}
+
+// pdn_bench [games] [threads] [file] writes random games and times
+// reading them back, pdn_bench file.pdn [threads] times an existing file
+int main(int argc, char **argv) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  bool existing = argc > 1 && atoi(argv[1]) == 0;
+  int threads = argc > 2 ? atoi(argv[2]) : (int)cpus;
+  if (threads < 1) {
+    fprintf(stderr, "usage: %s [games] [threads] [file] | %s file.pdn [threads]\n", argv[0], argv[0]);
+    return 2;
+  }
+  if (existing) {
+    return parse_and_report(argv[1], 1, NULL) && (threads == 1 || parse_and_report(argv[1], threads, NULL)) ? 0 : 1;
+  }
+  int game_count = argc > 1 ? atoi(argv[1]) : DEFAULT_GAMES;
+  const char *path = argc > 3 ? argv[3] : DEFAULT_FILE;
+  Totals written = {0};
+  double start = now_seconds();
+  if (!write_games(path, game_count, &written)) {
+    fprintf(stderr, "could not write %s\n", path);
+    return 1;
+  }
+  double elapsed = now_seconds() - start;
+  printf("wrote %d random games, %llu plies, %.0f games/min including play\n", game_count,
+         (unsigned long long)written.plies, game_count / elapsed * 60);
+  if (!parse_and_report(path, 1, &written) || (threads > 1 && !parse_and_report(path, threads, &written))) {
+    return 1;
+  }
+  printf("every game matches what was written\n");
+  return 0;
+}
@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "board.h"
+#include "moves.h"
+#include "timeman.h"
+
+#define DEFAULT_DEPTH 8
+
+// published leaf counts from the starting position, indexed by depth
+static const uint64_t start_position_perft[] = {
+  1, 7, 49, 302, 1469, 7361, 36768, 179740, 845931, 3963680,
+  18391564, 85242128, 388623673, 1766623630,
+};
+#define KNOWN_PERFT_DEPTH (int)(sizeof(start_position_perft) / sizeof(start_position_perft[0]) - 1)
+
+// both moves here are a king capturing its way round back to its own
+// square, which must still hold the king afterwards
+#define KING_LOOP_FEN "B:W17,18,22,24,25,26,27,28,31,32:B1,2,3,4,6,8,9,10,11,12,15,K30"
+#define KING_LOOP_DEPTH 6
+// leaf count below each of the two moves
+#define KING_LOOP_SPLIT 7335
+
+uint64_t perft(GameState *game, int depth) {
+  if (depth == 0) {
+    return 1;
+  }
+  MoveList moves;
+  int count = generate_moves(game, &moves);
+  // leaf moves only need to be counted, not played
+  if (depth == 1) {
+    return count;
+  }
+  uint64_t nodes = 0;
+  for (int i = 0; i < count; i++) {
+    make_move(game, &moves.moves[i]);
+    nodes += perft(game, depth - 1);
+    unmake_move(game, &moves.moves[i]);
+  }
+  return nodes;
+}
+
+// checks the split counts of the king loop position, whatever perft was asked for
+bool king_loop_matches(void) {
+  GameState game;
+  game_set_fen(&game, KING_LOOP_FEN);
+  MoveList moves;
+  if (generate_moves(&game, &moves) != 2) {
+    printf("MISMATCH: %s should have two moves, not %d\n", KING_LOOP_FEN, moves.count);
+    return false;
+  }
+  for (int i = 0; i < moves.count; i++) {
+    make_move(&game, &moves.moves[i]);
+    uint64_t nodes = perft(&game, KING_LOOP_DEPTH - 1);
+    unmake_move(&game, &moves.moves[i]);
+    if (nodes != KING_LOOP_SPLIT) {
+      char notation[64];
+      format_move(&moves.moves[i], notation, sizeof(notation));
+      printf("MISMATCH: %s from %s gives %llu at depth %d, expected %d\n", notation, KING_LOOP_FEN,
+             (unsigned long long)nodes, KING_LOOP_DEPTH, KING_LOOP_SPLIT);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int depth = DEFAULT_DEPTH;
+  if (argc > 1) {
+    depth = atoi(argv[1]);
+  }
+  if (depth < 1 || argc > 3) {
+    fprintf(stderr, "usage: %s [depth] [fen]\n", argv[0]);
+    return 2;
+  }
+  GameState game;
+  game_init(&game);
+  if (argc > 2 && !game_set_fen(&game, argv[2])) {
+    fprintf(stderr, "invalid fen: %s\n", argv[2]);
+    return 2;
+  }
+
+  double start = now_seconds();
+  MoveList moves;
+  generate_moves(&game, &moves);
+  uint64_t total = 0;
+  for (int i = 0; i < moves.count; i++) {
+    make_move(&game, &moves.moves[i]);
+    uint64_t nodes = perft(&game, depth - 1);
+    unmake_move(&game, &moves.moves[i]);
+    total += nodes;
+    char notation[64];
+    format_move(&moves.moves[i], notation, sizeof(notation));
+    printf("%-12s %llu\n", notation, (unsigned long long)nodes);
+  }
+  double elapsed = now_seconds() - start;
+
+  printf("\ndepth %d: %llu nodes in %.3f s", depth, (unsigned long long)total, elapsed);
+  if (elapsed > 0) {
+    printf(" (%.1f Mnodes/s)", total / elapsed / 1e6);
+  }
+  printf("\n");
+
+  if (is_initial_position(&game) && depth <= KNOWN_PERFT_DEPTH) {
+    uint64_t expected = start_position_perft[depth];
+    if (total != expected) {
+      printf("MISMATCH: expected %llu\n", (unsigned long long)expected);
+      return 1;
+    }
+    printf("matches known perft\n");
+  }
+  if (!king_loop_matches()) {
+    return 1;
+  }
+  printf("king capturing round to its own square matches\n");
+  return 0;
+}
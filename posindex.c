@@ -0,0 +1,315 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "posindex.h"
+#include "record.h"
+
+// a position one game reached, before it is sorted into its posting list
+typedef struct PostingEntry {
+  uint64_t hash;
+  uint32_t game;
+  uint16_t ply;
+  uint8_t next_move;
+} PostingEntry;
+
+// what an update collects before writing it out as a segment
+typedef struct SegmentBuilder {
+  PostingEntry *entries;
+  size_t entry_count;
+  uint64_t *record_offsets;
+  uint8_t *results;
+  size_t game_capacity;
+  uint32_t first_game;
+  uint32_t game_count;
+  uint64_t record_end;
+} SegmentBuilder;
+
+static inline size_t padded(size_t bytes) {
+  return (bytes + 7) & ~(size_t)7;
+}
+
+static size_t put_varint(uint8_t *buf, uint32_t v) {
+  size_t length = 0;
+  while (v >= 0x80) {
+    buf[length++] = (v & 0x7F) | 0x80;
+    v >>= 7;
+  }
+  buf[length++] = v;
+  return length;
+}
+
+// seven bits per byte, low groups first, the top bit marks that more follow
+static const uint8_t *read_varint(const uint8_t *p, uint32_t *v) {
+  uint32_t result = 0;
+  int shift = 0;
+  while (*p & 0x80) {
+    result |= (uint32_t)(*p++ & 0x7F) << shift;
+    shift += 7;
+  }
+  *v = result | (uint32_t)*p++ << shift;
+  return p;
+}
+
+static int compare_entries(const void *a, const void *b) {
+  const PostingEntry *x = a;
+  const PostingEntry *y = b;
+  if (x->hash != y->hash) {
+    return x->hash < y->hash ? -1 : 1;
+  }
+  if (x->game != y->game) {
+    return x->game < y->game ? -1 : 1;
+  }
+  return (int)x->ply - (int)y->ply;
+}
+
+// walks the segments of a mapped index, a segment cut short by a crash
+// during an update ends the index where it starts
+static size_t map_segments(PosIndex *index) {
+  size_t offset = 0;
+  int capacity = 0;
+  index->segments = NULL;
+  index->segment_count = 0;
+  index->game_count = 0;
+  index->record_end = 0;
+  while (index->size - offset >= sizeof(PosIndexSegmentHeader)) {
+    const uint8_t *base = index->map + offset;
+    const PosIndexSegmentHeader *header = (const PosIndexSegmentHeader *)base;
+    size_t games_bytes = header->game_count * sizeof(uint64_t) + padded(header->game_count);
+    size_t keys_bytes = header->key_count * sizeof(uint64_t) * 2 + sizeof(uint64_t);
+    if (header->magic != POSINDEX_MAGIC || header->version != POSINDEX_VERSION ||
+        header->first_game != index->game_count || header->segment_bytes > index->size - offset ||
+        header->segment_bytes != sizeof(*header) + games_bytes + keys_bytes + padded(header->postings_bytes)) {
+      break;
+    }
+    if (index->segment_count == capacity) {
+      capacity = capacity ? capacity * 2 : 8;
+      index->segments = realloc(index->segments, capacity * sizeof(PosIndexSegment));
+    }
+    PosIndexSegment *s = &index->segments[index->segment_count++];
+    s->header = header;
+    s->record_offsets = (const uint64_t *)(header + 1);
+    s->results = (const uint8_t *)(s->record_offsets + header->game_count);
+    s->keys = (const uint64_t *)(s->results + padded(header->game_count));
+    s->posting_starts = s->keys + header->key_count;
+    s->postings = (const uint8_t *)(s->posting_starts + header->key_count + 1);
+    index->game_count += header->game_count;
+    index->record_end = header->record_end;
+    offset += header->segment_bytes;
+  }
+  return offset;
+}
+
+static bool open_index(PosIndex *index, const char *path, size_t *valid_bytes) {
+  memset(index, 0, sizeof(*index));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  index->size = st.st_size;
+  if (index->size > 0) {
+    void *map = mmap(NULL, index->size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    index->map = map;
+    // lookups land on a few pages each, read ahead only wastes cache
+    posix_madvise(map, index->size, POSIX_MADV_RANDOM);
+  }
+  close(fd);
+  *valid_bytes = map_segments(index);
+  return true;
+}
+
+bool posindex_open(PosIndex *index, const char *path) {
+  size_t valid_bytes;
+  return open_index(index, path, &valid_bytes);
+}
+
+void posindex_close(PosIndex *index) {
+  if (index->map) {
+    munmap((void *)index->map, index->size);
+  }
+  free(index->segments);
+  memset(index, 0, sizeof(*index));
+}
+
+static bool write_padding(FILE *f, size_t bytes) {
+  static const uint8_t zeros[8];
+  return padded(bytes) == bytes || fwrite(zeros, padded(bytes) - bytes, 1, f) == 1;
+}
+
+static bool write_segment(FILE *f, SegmentBuilder *b) {
+  qsort(b->entries, b->entry_count, sizeof(PostingEntry), compare_entries);
+  // every entry adds at most one key and a varint plus a byte of postings
+  uint64_t *keys = malloc((b->entry_count + 1) * sizeof(uint64_t));
+  uint64_t *starts = malloc((b->entry_count + 1) * sizeof(uint64_t));
+  uint8_t *postings = malloc(b->entry_count * 6);
+  size_t key_count = 0;
+  size_t length = 0;
+  uint32_t previous_game = b->first_game;
+  for (size_t i = 0; i < b->entry_count; i++) {
+    const PostingEntry *e = &b->entries[i];
+    if (i == 0 || e->hash != b->entries[i - 1].hash) {
+      keys[key_count] = e->hash;
+      starts[key_count++] = length;
+      previous_game = b->first_game;
+    } else if (e->game == b->entries[i - 1].game) {
+      // a repetition, only the game's first visit is kept
+      continue;
+    }
+    length += put_varint(postings + length, e->game - previous_game);
+    postings[length++] = e->next_move;
+    previous_game = e->game;
+  }
+  starts[key_count] = length;
+
+  PosIndexSegmentHeader header = {
+    .magic = POSINDEX_MAGIC,
+    .version = POSINDEX_VERSION,
+    .first_game = b->first_game,
+    .game_count = b->game_count,
+    .key_count = key_count,
+    .postings_bytes = length,
+    .record_end = b->record_end,
+  };
+  header.segment_bytes = sizeof(header) + b->game_count * sizeof(uint64_t) + padded(b->game_count) +
+                         (key_count * 2 + 1) * sizeof(uint64_t) + padded(length);
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(b->record_offsets, sizeof(uint64_t), b->game_count, f) == b->game_count &&
+            fwrite(b->results, 1, b->game_count, f) == b->game_count && write_padding(f, b->game_count) &&
+            fwrite(keys, sizeof(uint64_t), key_count, f) == key_count &&
+            fwrite(starts, sizeof(uint64_t), key_count + 1, f) == key_count + 1 &&
+            (length == 0 || fwrite(postings, length, 1, f) == 1) && write_padding(f, length) &&
+            fflush(f) == 0 && fsync(fileno(f)) == 0;
+  free(keys);
+  free(starts);
+  free(postings);
+  b->first_game += b->game_count;
+  b->game_count = 0;
+  b->entry_count = 0;
+  return ok;
+}
+
+static void add_entry(SegmentBuilder *b, const GameState *position, int ply, int next_move) {
+  b->entries[b->entry_count++] = (PostingEntry){position->hash, b->first_game + b->game_count, ply, next_move};
+}
+
+long posindex_update(const char *index_path, const char *record_path) {
+  PosIndex index;
+  size_t valid_bytes = 0;
+  SegmentBuilder b = {0};
+  if (open_index(&index, index_path, &valid_bytes)) {
+    b.first_game = index.game_count;
+    b.record_end = index.record_end;
+    posindex_close(&index);
+  }
+  RecordReader r;
+  if (!record_reader_open(&r, record_path)) {
+    return -1;
+  }
+  if (b.record_end > 0 && !record_seek(&r, b.record_end)) {
+    record_reader_close(&r);
+    return -1;
+  }
+  FILE *f = fopen(index_path, "ab");
+  // drop what a crashed update left after the last whole segment
+  if (!f || ftruncate(fileno(f), valid_bytes) != 0) {
+    if (f) {
+      fclose(f);
+    }
+    record_reader_close(&r);
+    return -1;
+  }
+  b.entries = malloc(POSINDEX_SEGMENT_POSTINGS * sizeof(PostingEntry));
+  long added = 0;
+  bool ok = true;
+  RecordGame game;
+  long offset = record_tell(&r);
+  while (ok && record_next_game(&r, &game)) {
+    if (b.entry_count + game.ply_count + 1 > POSINDEX_SEGMENT_POSTINGS) {
+      ok = write_segment(f, &b);
+    }
+    if (b.game_count == b.game_capacity) {
+      b.game_capacity = b.game_capacity ? b.game_capacity * 2 : 4096;
+      b.record_offsets = realloc(b.record_offsets, b.game_capacity * sizeof(uint64_t));
+      b.results = realloc(b.results, b.game_capacity);
+    }
+    Move m;
+    int ply = 0;
+    GameState position = game.start;
+    while (record_next_move(&r, &m)) {
+      add_entry(&b, &position, ply++, r.move_index);
+      position = *record_position(&r);
+    }
+    if (r.corrupt) {
+      // a game still being written, the next update picks it up
+      b.entry_count -= ply;
+      break;
+    }
+    add_entry(&b, &position, ply, POSINDEX_GAME_END);
+    b.record_offsets[b.game_count] = offset;
+    b.results[b.game_count++] = game.result;
+    offset = record_tell(&r);
+    b.record_end = offset;
+    added++;
+  }
+  if (ok && b.game_count > 0) {
+    ok = write_segment(f, &b);
+  }
+  ok = (fclose(f) == 0) && ok;
+  record_reader_close(&r);
+  free(b.entries);
+  free(b.record_offsets);
+  free(b.results);
+  return ok ? added : -1;
+}
+
+uint64_t posindex_lookup(const PosIndex *index, uint64_t hash, PosIndexVisit visit, void *user) {
+  uint64_t found = 0;
+  for (int i = 0; i < index->segment_count; i++) {
+    const PosIndexSegment *s = &index->segments[i];
+    size_t low = 0;
+    size_t high = s->header->key_count;
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      if (s->keys[mid] < hash) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    if (low == s->header->key_count || s->keys[low] != hash) {
+      continue;
+    }
+    const uint8_t *p = s->postings + s->posting_starts[low];
+    const uint8_t *end = s->postings + s->posting_starts[low + 1];
+    uint32_t game = s->header->first_game;
+    while (p < end) {
+      uint32_t delta;
+      p = read_varint(p, &delta);
+      game += delta;
+      PosIndexHit hit = {
+        .game = game,
+        .record_offset = s->record_offsets[game - s->header->first_game],
+        .result = s->results[game - s->header->first_game],
+        .next_move = *p++,
+      };
+      found++;
+      if (visit) {
+        visit(user, &hit);
+      }
+    }
+  }
+  return found;
+}
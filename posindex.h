@@ -0,0 +1,87 @@
+#ifndef POSINDEX_H
+#define POSINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+#include "rules.h"
+
+#define POSINDEX_MAGIC 0x58444B43 // "CKDX"
+#define POSINDEX_VERSION 1
+// next move of a posting whose game ended in the position
+#define POSINDEX_GAME_END 0xFF
+// a segment is written once this many postings are waiting, which
+// bounds the memory an update needs
+#define POSINDEX_SEGMENT_POSTINGS (1 << 24)
+
+// an index file is a series of segments, each covering the games of a
+// record file that follow the ones before it, so new games are indexed
+// by appending a segment without touching the rest
+// a segment is this header followed by
+//   u64 record offsets[game_count], where each game starts in the record file
+//   u8 results[game_count], padded to 8 bytes
+//   u64 keys[key_count], the position hashes in increasing order
+//   u64 posting starts[key_count + 1], into the postings
+//   the postings, padded to 8 bytes: for every game that reached a
+//   position, the game number's distance from the one before (from
+//   first_game for the first) as a varint, then the index in
+//   generate_moves order of the move the game went on with
+// integers are in the machine's byte order so the arrays are used in place
+typedef struct PosIndexSegmentHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t first_game;
+  uint32_t game_count;
+  uint64_t key_count;
+  uint64_t postings_bytes;
+  // the record file offset just past this segment's last game
+  uint64_t record_end;
+  // the whole segment, header included
+  uint64_t segment_bytes;
+} PosIndexSegmentHeader;
+
+typedef struct PosIndexSegment {
+  const PosIndexSegmentHeader *header;
+  const uint64_t *record_offsets;
+  const uint8_t *results;
+  const uint64_t *keys;
+  const uint64_t *posting_starts;
+  const uint8_t *postings;
+} PosIndexSegment;
+
+// a read only view of an index file, shared with every other process
+// that maps it
+typedef struct PosIndex {
+  const uint8_t *map;
+  size_t size;
+  PosIndexSegment *segments;
+  int segment_count;
+  uint32_t game_count;
+  // where the first game the index has not seen yet starts
+  uint64_t record_end;
+} PosIndex;
+
+// one game that reached a position
+typedef struct PosIndexHit {
+  uint32_t game;
+  uint64_t record_offset;
+  GameResult result;
+  // POSINDEX_GAME_END when the game ended in the position
+  int next_move;
+} PosIndexHit;
+
+typedef void (*PosIndexVisit)(void *user, const PosIndexHit *hit);
+
+// indexes the games of record_path the index does not cover yet,
+// creating the index when it does not exist, returns the number of
+// games added or -1 on failure
+long posindex_update(const char *index_path, const char *record_path);
+
+bool posindex_open(PosIndex *index, const char *path);
+void posindex_close(PosIndex *index);
+// calls visit, in game order, for every game that reached a position
+// with this hash, and returns how many did
+// a game that repeated the position counts once, with its first visit
+uint64_t posindex_lookup(const PosIndex *index, uint64_t hash, PosIndexVisit visit, void *user);
+
+#endif
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <string.h>
+#include "posindex.h"
+#include "timeman.h"
+
+#define DEFAULT_RECORD "games.ckr"
+#define DEFAULT_INDEX "games.cki"
+
+// posindex_build [record] [index] [--rebuild] indexes the games added
+// to the record file since the last run, --rebuild starts over and
+// merges every segment into one
+int main(int argc, char **argv) {
+  const char *paths[2] = {DEFAULT_RECORD, DEFAULT_INDEX};
+  int path_count = 0;
+  bool rebuild = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rebuild") == 0) {
+      rebuild = true;
+    } else if (path_count < 2) {
+      paths[path_count++] = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [record] [index] [--rebuild]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (rebuild) {
+    remove(paths[1]);
+  }
+  double start = now_seconds();
+  long added = posindex_update(paths[1], paths[0]);
+  double elapsed = now_seconds() - start;
+  if (added < 0) {
+    fprintf(stderr, "could not index %s into %s\n", paths[0], paths[1]);
+    return 1;
+  }
+  PosIndex index;
+  if (!posindex_open(&index, paths[1])) {
+    fprintf(stderr, "could not open %s\n", paths[1]);
+    return 1;
+  }
+  uint64_t keys = 0;
+  for (int i = 0; i < index.segment_count; i++) {
+    keys += index.segments[i].header->key_count;
+  }
+  printf("added %ld games in %.2f s, %u games in %d segment%s, %llu keys, %.1f MB\n", added, elapsed,
+         index.game_count, index.segment_count, index.segment_count == 1 ? "" : "s",
+         (unsigned long long)keys, index.size / 1e6);
+  posindex_close(&index);
+  return 0;
+}
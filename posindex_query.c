@@ -0,0 +1,145 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+#include "record.h"
+#include "posindex.h"
+#include "timeman.h"
+
+#define DEFAULT_INDEX "games.cki"
+#define DEFAULT_RECORD "games.ckr"
+#define LISTED_GAMES 10
+// games whose positions are looked up when no position is given
+#define SAMPLE_GAMES 1000
+
+// what the games that reached one position went on to do
+typedef struct QueryStats {
+  uint64_t games;
+  uint64_t results[GAME_DRAW + 1];
+  uint64_t move_games[MAX_MOVES + 1];
+  uint64_t move_results[MAX_MOVES + 1][GAME_DRAW + 1];
+  PosIndexHit listed[LISTED_GAMES];
+  // for checking the sample, the game that has to be among the hits
+  uint32_t expected_game;
+  bool expected_found;
+} QueryStats;
+
+static void add_hit(void *user, const PosIndexHit *hit) {
+  QueryStats *stats = user;
+  int move = hit->next_move == POSINDEX_GAME_END ? MAX_MOVES : hit->next_move;
+  if (stats->games < LISTED_GAMES) {
+    stats->listed[stats->games] = *hit;
+  }
+  stats->games++;
+  stats->results[hit->result]++;
+  stats->move_games[move]++;
+  stats->move_results[move][hit->result]++;
+  stats->expected_found |= hit->game == stats->expected_game;
+}
+
+static void print_results(const uint64_t *results) {
+  printf("black wins %llu, red wins %llu, draws %llu, unfinished %llu",
+         (unsigned long long)results[GAME_PLAYER_TWO_WINS], (unsigned long long)results[GAME_PLAYER_ONE_WINS],
+         (unsigned long long)results[GAME_DRAW], (unsigned long long)results[GAME_ONGOING]);
+}
+
+static int query(const PosIndex *index, const GameState *position) {
+  static QueryStats stats;
+  double start = now_seconds();
+  posindex_lookup(index, position->hash, add_hit, &stats);
+  double elapsed = now_seconds() - start;
+  printf("%llu games in %.3f ms: ", (unsigned long long)stats.games, elapsed * 1e3);
+  print_results(stats.results);
+  printf("\n");
+  MoveList moves;
+  generate_moves(position, &moves);
+  for (int i = 0; i <= MAX_MOVES; i++) {
+    if (!stats.move_games[i]) {
+      continue;
+    }
+    char notation[64] = "game over";
+    if (i < moves.count) {
+      format_move(&moves.moves[i], notation, sizeof(notation));
+    } else if (i != MAX_MOVES) {
+      snprintf(notation, sizeof(notation), "move %d?", i);
+    }
+    printf("  %-12s %6llu games, ", notation, (unsigned long long)stats.move_games[i]);
+    print_results(stats.move_results[i]);
+    printf("\n");
+  }
+  for (uint64_t i = 0; i < stats.games && i < LISTED_GAMES; i++) {
+    printf("  game %u at record offset %llu\n", stats.listed[i].game,
+           (unsigned long long)stats.listed[i].record_offset);
+  }
+  return 0;
+}
+
+// looks up every position of the first games of the record and checks
+// each game is among the hits of the positions it reached
+static int sample(const PosIndex *index, const char *record_path) {
+  RecordReader r;
+  if (!record_reader_open(&r, record_path)) {
+    fprintf(stderr, "could not open %s\n", record_path);
+    return 1;
+  }
+  RecordGame game;
+  uint64_t lookups = 0;
+  uint64_t hits = 0;
+  uint64_t missing = 0;
+  double elapsed = 0;
+  for (uint32_t g = 0; g < SAMPLE_GAMES && g < index->game_count && record_next_game(&r, &game); g++) {
+    GameState position = game.start;
+    Move m;
+    bool more = true;
+    while (more) {
+      static QueryStats stats;
+      stats.games = 0;
+      stats.expected_game = g;
+      stats.expected_found = false;
+      double start = now_seconds();
+      hits += posindex_lookup(index, position.hash, add_hit, &stats);
+      elapsed += now_seconds() - start;
+      lookups++;
+      missing += !stats.expected_found;
+      more = record_next_move(&r, &m);
+      position = *record_position(&r);
+    }
+  }
+  record_reader_close(&r);
+  printf("%llu lookups, %.1f us each, %.1f games per position, %llu games missing from their positions\n",
+         (unsigned long long)lookups, elapsed / lookups * 1e6, (double)hits / lookups,
+         (unsigned long long)missing);
+  return missing ? 1 : 0;
+}
+
+// posindex_query [index] [record] [fen] lists the games that reached
+// the position, the initial one by default, or with "sample" instead
+// of a FEN checks and times lookups of positions from the record
+int main(int argc, char **argv) {
+  const char *index_path = argc > 1 ? argv[1] : DEFAULT_INDEX;
+  const char *record_path = argc > 2 ? argv[2] : DEFAULT_RECORD;
+  PosIndex index;
+  if (!posindex_open(&index, index_path)) {
+    fprintf(stderr, "could not open %s\n", index_path);
+    return 1;
+  }
+  printf("%u games in %d segment%s\n", index.game_count, index.segment_count, index.segment_count == 1 ? "" : "s");
+  int status;
+  if (argc > 3 && strcmp(argv[3], "sample") == 0) {
+    status = sample(&index, record_path);
+  } else {
+    GameState position;
+    game_init(&position);
+    if (argc > 3 && !game_set_fen(&position, argv[3])) {
+      fprintf(stderr, "invalid FEN: %s\n", argv[3]);
+      posindex_close(&index);
+      return 2;
+    }
+    status = query(&index, &position);
+  }
+  posindex_close(&index);
+  return status;
+}
@@ -0,0 +1,226 @@
+#include <string.h>
+#include "protocol.h"
+
+// bounds checked cursor over a message payload
+typedef struct Cursor {
+  uint8_t *data;
+  size_t length;
+  size_t pos;
+  bool overflow;
+} Cursor;
+
+static void put_u8(Cursor *c, uint8_t v) {
+  if (c->pos + 1 > c->length) {
+    c->overflow = true;
+    return;
+  }
+  c->data[c->pos++] = v;
+}
+
+static void put_u16(Cursor *c, uint16_t v) {
+  put_u8(c, v >> 8);
+  put_u8(c, v);
+}
+
+static void put_u32(Cursor *c, uint32_t v) {
+  put_u16(c, v >> 16);
+  put_u16(c, v);
+}
+
+static uint8_t get_u8(Cursor *c) {
+  if (c->pos + 1 > c->length) {
+    c->overflow = true;
+    return 0;
+  }
+  return c->data[c->pos++];
+}
+
+static uint16_t get_u16(Cursor *c) {
+  uint16_t high = get_u8(c);
+  return (high << 8) | get_u8(c);
+}
+
+static uint32_t get_u32(Cursor *c) {
+  uint32_t high = get_u16(c);
+  return (high << 16) | get_u16(c);
+}
+
+static void put_move(Cursor *c, const WireMove *move) {
+  put_u8(c, move->from);
+  put_u8(c, move->step_count);
+  for (int i = 0; i < move->step_count; i++) {
+    put_u8(c, move->steps[i]);
+  }
+}
+
+static bool get_move(Cursor *c, WireMove *move) {
+  move->from = get_u8(c);
+  move->step_count = get_u8(c);
+  if (move->from >= SQUARE_COUNT || move->step_count < 1 || move->step_count > MAX_JUMP_COUNT) {
+    return false;
+  }
+  for (int i = 0; i < move->step_count; i++) {
+    move->steps[i] = get_u8(c);
+    if (move->steps[i] >= SQUARE_COUNT) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t message_encode(const Message *m, uint8_t *buf, size_t size) {
+  Cursor c = {buf, size, PROTOCOL_HEADER_SIZE, false};
+  switch (m->type) {
+  case MSG_NEW_GAME: {
+    put_u8(&c, m->seats);
+    size_t fen_length = 0;
+    while (fen_length < PROTOCOL_MAX_FEN && m->fen[fen_length]) {
+      fen_length++;
+    }
+    for (size_t i = 0; i < fen_length; i++) {
+      put_u8(&c, m->fen[i]);
+    }
+    break;
+  }
+  case MSG_JOIN:
+    put_u32(&c, m->game_id);
+    put_u8(&c, m->seats);
+    break;
+  case MSG_MOVE:
+    put_u32(&c, m->game_id);
+    put_move(&c, &m->move);
+    break;
+  case MSG_LEAVE:
+    put_u32(&c, m->game_id);
+    break;
+  case MSG_STATE:
+    put_u32(&c, m->game_id);
+    put_u16(&c, m->ply);
+    for (int i = 0; i < PLAYER_COUNT; i++) {
+      put_u32(&c, m->men[i]);
+      put_u32(&c, m->kings[i]);
+    }
+    put_u8(&c, m->current_player);
+    put_u8(&c, m->result);
+    break;
+  case MSG_MOVED:
+    put_u32(&c, m->game_id);
+    put_u16(&c, m->ply);
+    put_move(&c, &m->move);
+    put_u32(&c, m->captured);
+    put_u8(&c, m->promotes);
+    put_u8(&c, m->result);
+    break;
+  case MSG_ERROR:
+    put_u32(&c, m->game_id);
+    put_u8(&c, m->error);
+    break;
+  default:
+    return 0;
+  }
+  size_t payload = c.pos - PROTOCOL_HEADER_SIZE;
+  if (c.overflow || payload > PROTOCOL_MAX_PAYLOAD) {
+    return 0;
+  }
+  buf[0] = payload >> 8;
+  buf[1] = payload;
+  buf[2] = m->type;
+  return c.pos;
+}
+
+int message_decode(const uint8_t *buf, size_t length, Message *m) {
+  if (length < PROTOCOL_HEADER_SIZE) {
+    return 0;
+  }
+  size_t payload = ((size_t)buf[0] << 8) | buf[1];
+  if (payload > PROTOCOL_MAX_PAYLOAD) {
+    return -1;
+  }
+  if (length < PROTOCOL_HEADER_SIZE + payload) {
+    return 0;
+  }
+  Cursor c = {(uint8_t *)buf + PROTOCOL_HEADER_SIZE, payload, 0, false};
+  memset(m, 0, sizeof(*m));
+  m->type = buf[2];
+  bool valid = true;
+  switch (m->type) {
+  case MSG_NEW_GAME: {
+    m->seats = get_u8(&c);
+    size_t fen_length = payload > 0 ? payload - 1 : 0;
+    valid = fen_length <= PROTOCOL_MAX_FEN;
+    for (size_t i = 0; valid && i < fen_length; i++) {
+      m->fen[i] = get_u8(&c);
+    }
+    valid = valid && m->seats >= 1 && m->seats <= (SEAT_PLAYER_ONE | SEAT_PLAYER_TWO);
+    break;
+  }
+  case MSG_JOIN:
+    m->game_id = get_u32(&c);
+    m->seats = get_u8(&c);
+    valid = m->seats >= 1 && m->seats <= (SEAT_PLAYER_ONE | SEAT_PLAYER_TWO);
+    break;
+  case MSG_MOVE:
+    m->game_id = get_u32(&c);
+    valid = get_move(&c, &m->move);
+    break;
+  case MSG_LEAVE:
+    m->game_id = get_u32(&c);
+    break;
+  case MSG_STATE:
+    m->game_id = get_u32(&c);
+    m->ply = get_u16(&c);
+    for (int i = 0; i < PLAYER_COUNT; i++) {
+      m->men[i] = get_u32(&c);
+      m->kings[i] = get_u32(&c);
+    }
+    m->current_player = get_u8(&c);
+    m->result = get_u8(&c);
+    valid = m->current_player < PLAYER_COUNT && m->result <= GAME_DRAW;
+    break;
+  case MSG_MOVED:
+    m->game_id = get_u32(&c);
+    m->ply = get_u16(&c);
+    valid = get_move(&c, &m->move);
+    m->captured = get_u32(&c);
+    m->promotes = get_u8(&c);
+    m->result = get_u8(&c);
+    valid = valid && m->result <= GAME_DRAW;
+    break;
+  case MSG_ERROR:
+    m->game_id = get_u32(&c);
+    m->error = get_u8(&c);
+    break;
+  default:
+    valid = false;
+  }
+  // trailing bytes are as malformed as missing ones
+  if (!valid || c.overflow || c.pos != payload) {
+    return -1;
+  }
+  return PROTOCOL_HEADER_SIZE + payload;
+}
+
+void wire_move_from_move(const Move *m, WireMove *wire) {
+  wire->from = m->from;
+  if (is_capture(m)) {
+    wire->step_count = m->jump_count;
+    memcpy(wire->steps, m->path, m->jump_count);
+  } else {
+    wire->step_count = 1;
+    wire->steps[0] = m->to;
+  }
+}
+
+const Move *find_wire_move(const MoveList *moves, const WireMove *wire) {
+  for (int i = 0; i < moves->count; i++) {
+    const Move *m = &moves->moves[i];
+    if (m->from != wire->from) {
+      continue;
+    }
+    if (is_capture(m) ? (m->jump_count == wire->step_count && memcmp(m->path, wire->steps, m->jump_count) == 0)
+                      : (wire->step_count == 1 && wire->steps[0] == m->to)) {
+      return m;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,86 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+
+// every message is a 2 byte big endian payload length, a 1 byte type
+// and the payload, integers in the payload are big endian too
+#define PROTOCOL_HEADER_SIZE 3
+#define PROTOCOL_MAX_PAYLOAD 255
+#define PROTOCOL_MAX_MESSAGE (PROTOCOL_HEADER_SIZE + PROTOCOL_MAX_PAYLOAD)
+#define PROTOCOL_MAX_FEN 200
+#define DEFAULT_PORT 7777
+
+// seats a connection takes in a game, both for playing against itself
+#define SEAT_PLAYER_ONE (1 << PLAYER_ONE)
+#define SEAT_PLAYER_TWO (1 << PLAYER_TWO)
+
+typedef enum MessageType {
+  // client to server
+  MSG_NEW_GAME = 1,   // seats, optional fen
+  MSG_JOIN = 2,       // game id, seats
+  MSG_MOVE = 3,       // game id, move
+  MSG_LEAVE = 4,      // game id
+  // server to client
+  MSG_STATE = 0x81,   // game id, ply, pieces, side to move, result
+  MSG_MOVED = 0x82,   // game id, ply, move, captured, promotes, result
+  MSG_ERROR = 0x83,   // game id, error code
+} MessageType;
+
+typedef enum ProtocolError {
+  ERR_NONE,
+  ERR_BAD_MESSAGE,
+  ERR_UNKNOWN_GAME,
+  ERR_SEAT_TAKEN,
+  ERR_NOT_YOUR_TURN,
+  ERR_ILLEGAL_MOVE,
+  ERR_GAME_OVER,
+  ERR_BAD_FEN,
+  ERR_SERVER_FULL,
+} ProtocolError;
+
+// a move as sent over the wire: the start square and every landing
+// square, which tells apart capture paths that end on the same square
+typedef struct WireMove {
+  uint8_t from;
+  uint8_t step_count;
+  uint8_t steps[MAX_JUMP_COUNT];
+} WireMove;
+
+// the fields a message type does not use are ignored
+typedef struct Message {
+  MessageType type;
+  // game ids are only meaningful on the connection's own server loop
+  uint32_t game_id;
+  uint8_t seats;
+  ProtocolError error;
+  uint16_t ply;
+  GameResult result;
+  WireMove move;
+  // the state diff of MSG_MOVED, enough to apply the move without
+  // generating moves
+  Bitboard captured;
+  bool promotes;
+  // MSG_STATE sends the whole position
+  Bitboard men[PLAYER_COUNT];
+  Bitboard kings[PLAYER_COUNT];
+  uint8_t current_player;
+  // MSG_NEW_GAME, empty for the initial position
+  char fen[PROTOCOL_MAX_FEN + 1];
+} Message;
+
+// writes m to buf and returns its length, 0 when it does not fit
+size_t message_encode(const Message *m, uint8_t *buf, size_t size);
+// reads one message from the start of buf, returns the bytes it took,
+// 0 when buf does not hold a whole message yet and -1 when it is malformed
+int message_decode(const uint8_t *buf, size_t length, Message *m);
+
+void wire_move_from_move(const Move *m, WireMove *wire);
+// the legal move wire describes, NULL when there is none
+const Move *find_wire_move(const MoveList *moves, const WireMove *wire);
+
+#endif
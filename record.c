@@ -0,0 +1,207 @@
+#include <string.h>
+#include "record.h"
+#include "zobrist.h"
+
+static void put_u16(uint8_t *buf, uint16_t v) {
+  buf[0] = v;
+  buf[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *buf, uint32_t v) {
+  put_u16(buf, v);
+  put_u16(buf + 2, v >> 16);
+}
+
+static uint16_t get_u16(const uint8_t *buf) {
+  return buf[0] | (buf[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *buf) {
+  return get_u16(buf) | ((uint32_t)get_u16(buf + 2) << 16);
+}
+
+// bits needed for an index into a list of count moves, a forced move
+// needs none because the reader knows it without being told
+static inline int index_bits(int count) {
+  return count > 1 ? 32 - __builtin_clz(count - 1) : 0;
+}
+
+bool record_writer_open(RecordWriter *w, const char *path) {
+  memset(w, 0, sizeof(*w));
+  w->file = fopen(path, "wb");
+  if (!w->file) {
+    return false;
+  }
+  uint8_t header[8];
+  put_u32(header, RECORD_MAGIC);
+  put_u32(header + 4, RECORD_VERSION);
+  return fwrite(header, sizeof(header), 1, w->file) == 1;
+}
+
+void record_begin_game(RecordWriter *w, const GameState *start) {
+  if (start) {
+    w->start = *start;
+  } else {
+    game_init(&w->start);
+  }
+  w->custom_start = !is_initial_position(&w->start);
+  w->position = w->start;
+  w->position.hash = compute_hash(&w->position);
+  w->move_bits = 0;
+  w->plies = 0;
+  memset(w->moves, 0, sizeof(w->moves));
+}
+
+bool record_add_move(RecordWriter *w, const Move *m) {
+  if (w->plies >= MAX_GAME_PLIES) {
+    return false;
+  }
+  MoveList moves;
+  int count = generate_moves(&w->position, &moves);
+  // capture paths that only differ in their order reach the same
+  // position, so the first one that matches is as good as any
+  int index = 0;
+  while (index < count && !(moves.moves[index].from == m->from && moves.moves[index].to == m->to &&
+                            moves.moves[index].captured == m->captured)) {
+    index++;
+  }
+  if (index == count) {
+    return false;
+  }
+  // indices are packed least significant bit first
+  for (int bit = 0; bit < index_bits(count); bit++) {
+    if (index & (1 << bit)) {
+      w->moves[w->move_bits >> 3] |= 1 << (w->move_bits & 7);
+    }
+    w->move_bits++;
+  }
+  make_move(&w->position, &moves.moves[index]);
+  w->plies++;
+  return true;
+}
+
+bool record_end_game(RecordWriter *w, GameResult result) {
+  uint8_t header[RECORD_GAME_HEADER_SIZE + RECORD_POSITION_SIZE];
+  size_t length = RECORD_GAME_HEADER_SIZE;
+  header[0] = result;
+  header[1] = w->custom_start ? RECORD_CUSTOM_START : 0;
+  put_u16(header + 2, w->plies);
+  int move_bytes = (w->move_bits + 7) / 8;
+  put_u16(header + 4, move_bytes);
+  if (w->custom_start) {
+    for (int i = 0; i < PLAYER_COUNT; i++) {
+      put_u32(header + length, w->start.players[i].men);
+      put_u32(header + length + 4, w->start.players[i].kings);
+      length += 8;
+    }
+    header[length++] = w->start.current_player;
+  }
+  if (fwrite(header, length, 1, w->file) != 1 ||
+      (move_bytes > 0 && fwrite(w->moves, move_bytes, 1, w->file) != 1)) {
+    return false;
+  }
+  w->games++;
+  return true;
+}
+
+bool record_writer_close(RecordWriter *w) {
+  bool ok = w->file && fclose(w->file) == 0;
+  w->file = NULL;
+  return ok;
+}
+
+bool record_reader_open(RecordReader *r, const char *path) {
+  memset(r, 0, sizeof(*r));
+  r->file = fopen(path, "rb");
+  if (!r->file) {
+    return false;
+  }
+  uint8_t header[8];
+  if (fread(header, sizeof(header), 1, r->file) != 1 ||
+      get_u32(header) != RECORD_MAGIC || get_u32(header + 4) != RECORD_VERSION) {
+    fclose(r->file);
+    r->file = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool record_next_game(RecordReader *r, RecordGame *game) {
+  uint8_t header[RECORD_GAME_HEADER_SIZE + RECORD_POSITION_SIZE];
+  size_t read = fread(header, 1, RECORD_GAME_HEADER_SIZE, r->file);
+  if (read != RECORD_GAME_HEADER_SIZE) {
+    // a clean end of file falls exactly between two games
+    r->corrupt = read != 0;
+    return false;
+  }
+  game->result = header[0];
+  game->ply_count = get_u16(header + 2);
+  r->move_bytes = get_u16(header + 4);
+  game_init(&game->start);
+  if (header[1] & RECORD_CUSTOM_START) {
+    uint8_t *p = header + RECORD_GAME_HEADER_SIZE;
+    if (fread(p, RECORD_POSITION_SIZE, 1, r->file) != 1) {
+      r->corrupt = true;
+      return false;
+    }
+    for (int i = 0; i < PLAYER_COUNT; i++) {
+      game->start.players[i].men = get_u32(p + i * 8);
+      game->start.players[i].kings = get_u32(p + i * 8 + 4);
+    }
+    game->start.current_player = p[16];
+    game->start.hash = compute_hash(&game->start);
+  }
+  if (game->result > GAME_DRAW || game->start.current_player >= PLAYER_COUNT ||
+      game->ply_count > MAX_GAME_PLIES || r->move_bytes > game->ply_count ||
+      (r->move_bytes > 0 && fread(r->moves, r->move_bytes, 1, r->file) != 1)) {
+    r->corrupt = true;
+    return false;
+  }
+  r->position = game->start;
+  r->next_bit = 0;
+  r->plies_left = game->ply_count;
+  return true;
+}
+
+bool record_next_move(RecordReader *r, Move *m) {
+  if (r->plies_left == 0) {
+    return false;
+  }
+  MoveList moves;
+  int count = generate_moves(&r->position, &moves);
+  int bits = index_bits(count);
+  int index = 0;
+  if (r->next_bit + bits > r->move_bytes * 8) {
+    index = count;
+  }
+  for (int bit = 0; bit < bits && index < count; bit++, r->next_bit++) {
+    index |= ((r->moves[r->next_bit >> 3] >> (r->next_bit & 7)) & 1) << bit;
+  }
+  if (index >= count) {
+    r->corrupt = true;
+    r->plies_left = 0;
+    return false;
+  }
+  *m = moves.moves[index];
+  r->move_index = index;
+  make_move(&r->position, m);
+  r->plies_left--;
+  return true;
+}
+
+long record_tell(const RecordReader *r) {
+  return ftell(r->file);
+}
+
+bool record_seek(RecordReader *r, long offset) {
+  r->plies_left = 0;
+  r->corrupt = false;
+  return fseek(r->file, offset, SEEK_SET) == 0;
+}
+
+void record_reader_close(RecordReader *r) {
+  if (r->file) {
+    fclose(r->file);
+  }
+  r->file = NULL;
+}
@@ -0,0 +1,79 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+
+// a record file is an 8 byte header followed by games, each game is
+//   u8 result, u8 flags, u16 ply count, u16 move bytes,
+//   the start position when RECORD_CUSTOM_START is set:
+//     u32 men and kings of each player, u8 side to move
+//   the move bytes: for every ply, the move's index in generate_moves
+//   order in just enough bits for the number of legal moves, packed
+//   least significant bit first, so forced moves take no space at all
+// all integers are little endian
+#define RECORD_MAGIC 0x52474B43 // "CKGR"
+#define RECORD_VERSION 1
+#define RECORD_CUSTOM_START 1
+#define RECORD_GAME_HEADER_SIZE 6
+#define RECORD_POSITION_SIZE 17
+
+typedef struct RecordWriter {
+  FILE *file;
+  GameState start;
+  bool custom_start;
+  // the position reached by the moves added so far
+  GameState position;
+  // at most 7 bits per ply, MAX_MOVES fits in them
+  uint8_t moves[MAX_GAME_PLIES];
+  int move_bits;
+  int plies;
+  uint64_t games;
+} RecordWriter;
+
+typedef struct RecordGame {
+  GameState start;
+  int ply_count;
+  GameResult result;
+} RecordGame;
+
+typedef struct RecordReader {
+  FILE *file;
+  GameState position;
+  uint8_t moves[MAX_GAME_PLIES];
+  int move_bytes;
+  int next_bit;
+  int plies_left;
+  // where the last move read stood in generate_moves order
+  int move_index;
+  // set when a read failed on anything but a clean end of file
+  bool corrupt;
+} RecordReader;
+
+bool record_writer_open(RecordWriter *w, const char *path);
+// starts a game from start, or from the initial position when start is NULL
+void record_begin_game(RecordWriter *w, const GameState *start);
+// m must be legal in the position reached so far, returns false otherwise
+bool record_add_move(RecordWriter *w, const Move *m);
+bool record_end_game(RecordWriter *w, GameResult result);
+bool record_writer_close(RecordWriter *w);
+
+bool record_reader_open(RecordReader *r, const char *path);
+// moves on to the next game, skipping what is left of the current one,
+// returns false at the end of the file or on a damaged record
+bool record_next_game(RecordReader *r, RecordGame *game);
+// replays the next move of the current game into m, false after its last
+bool record_next_move(RecordReader *r, Move *m);
+// the position after the moves read so far
+static inline const GameState *record_position(const RecordReader *r) {
+  return &r->position;
+}
+// byte offset of the next game, so it can be found again with record_seek
+long record_tell(const RecordReader *r);
+bool record_seek(RecordReader *r, long offset);
+void record_reader_close(RecordReader *r);
+
+#endif
@@ -0,0 +1,201 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+#include "record.h"
+#include "pdn.h"
+#include "timeman.h"
+
+#define DEFAULT_GAMES 100000
+#define DEFAULT_FILE "games.ckr"
+// every this many games start from a few random moves in, so custom
+// start positions are covered too
+#define CUSTOM_START_EVERY 10
+#define CUSTOM_START_PLIES 6
+
+// what the round trip has to reproduce for one game
+typedef struct GameSample {
+  GameState start;
+  // offset of the game's move indices in the shared index array
+  size_t first_index;
+  int ply_count;
+  GameResult result;
+  uint64_t final_hash;
+} GameSample;
+
+static uint64_t next_random(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+// random games are far more varied than engine games, which makes them
+// a fair worst case for the size of the move bytes
+static uint8_t *generate_games(GameSample *samples, int game_count, size_t *total_plies) {
+  size_t capacity = (size_t)game_count * 64;
+  uint8_t *indices = malloc(capacity);
+  size_t used = 0;
+  uint64_t random = 0x9E3779B97F4A7C15ULL;
+  static Game game;
+  for (int g = 0; g < game_count; g++) {
+    GameSample *s = &samples[g];
+    game_start(&game);
+    if (g % CUSTOM_START_EVERY == CUSTOM_START_EVERY - 1) {
+      for (int i = 0; i < CUSTOM_START_PLIES && game.result == GAME_ONGOING; i++) {
+        MoveList moves;
+        int count = generate_moves(&game.state, &moves);
+        game_play(&game, &moves.moves[next_random(&random) % count]);
+      }
+      GameState start = game.state;
+      game_resume(&game, &start, 0);
+    }
+    s->start = game.state;
+    s->first_index = used;
+    while (game.result == GAME_ONGOING) {
+      MoveList moves;
+      int count = generate_moves(&game.state, &moves);
+      int index = next_random(&random) % count;
+      if (used == capacity) {
+        capacity *= 2;
+        indices = realloc(indices, capacity);
+      }
+      indices[used++] = index;
+      game_play(&game, &moves.moves[index]);
+    }
+    s->ply_count = game.ply;
+    s->result = game.result;
+    s->final_hash = game.state.hash;
+  }
+  *total_plies = used;
+  return indices;
+}
+
+static bool write_binary(const char *path, const GameSample *samples, int game_count, const uint8_t *indices) {
+  RecordWriter w;
+  if (!record_writer_open(&w, path)) {
+    return false;
+  }
+  for (int g = 0; g < game_count; g++) {
+    const GameSample *s = &samples[g];
+    GameState position = s->start;
+    record_begin_game(&w, &position);
+    for (int i = 0; i < s->ply_count; i++) {
+      MoveList moves;
+      generate_moves(&position, &moves);
+      const Move *m = &moves.moves[indices[s->first_index + i]];
+      if (!record_add_move(&w, m)) {
+        return false;
+      }
+      make_move(&position, m);
+    }
+    if (!record_end_game(&w, s->result)) {
+      return false;
+    }
+  }
+  return record_writer_close(&w);
+}
+
+// the same games as PDN, only to compare sizes
+static long write_text(const char *path, const GameSample *samples, int game_count, const uint8_t *indices) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    return -1;
+  }
+  PdnWriter w;
+  pdn_writer_init(&w, f);
+  for (int g = 0; g < game_count; g++) {
+    const GameSample *s = &samples[g];
+    pdn_begin_game(&w, NULL, &s->start, s->result);
+    for (int i = 0; i < s->ply_count; i++) {
+      MoveList moves;
+      generate_moves(&w.position, &moves);
+      pdn_write_move(&w, &moves.moves[indices[s->first_index + i]]);
+    }
+    pdn_end_game(&w);
+  }
+  long size = ftell(f);
+  fclose(f);
+  return size;
+}
+
+// reads every game back and checks it against what was written
+static bool read_binary(const char *path, const GameSample *samples, int game_count, uint64_t *plies_read) {
+  RecordReader r;
+  if (!record_reader_open(&r, path)) {
+    return false;
+  }
+  RecordGame game;
+  int g = 0;
+  *plies_read = 0;
+  for (; record_next_game(&r, &game); g++) {
+    if (g >= game_count) {
+      fprintf(stderr, "more games read than written\n");
+      return false;
+    }
+    const GameSample *s = &samples[g];
+    Move m;
+    int plies = 0;
+    while (record_next_move(&r, &m)) {
+      plies++;
+    }
+    *plies_read += plies;
+    if (plies != s->ply_count || game.ply_count != s->ply_count || game.result != s->result ||
+        game.start.hash != s->start.hash || record_position(&r)->hash != s->final_hash) {
+      fprintf(stderr, "game %d does not match what was written\n", g);
+      return false;
+    }
+  }
+  bool ok = !r.corrupt && g == game_count;
+  record_reader_close(&r);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int game_count = argc > 1 ? atoi(argv[1]) : DEFAULT_GAMES;
+  const char *path = argc > 2 ? argv[2] : DEFAULT_FILE;
+  if (game_count < 1) {
+    fprintf(stderr, "usage: %s [games] [file]\n", argv[0]);
+    return 2;
+  }
+  GameSample *samples = malloc(game_count * sizeof(GameSample));
+  size_t total_plies;
+  uint8_t *indices = generate_games(samples, game_count, &total_plies);
+  printf("%d random games, %zu plies\n", game_count, total_plies);
+
+  double start = now_seconds();
+  if (!write_binary(path, samples, game_count, indices)) {
+    fprintf(stderr, "could not write %s\n", path);
+    return 1;
+  }
+  double write_time = now_seconds() - start;
+  FILE *f = fopen(path, "rb");
+  fseek(f, 0, SEEK_END);
+  long binary_size = ftell(f);
+  fclose(f);
+
+  char text_path[512];
+  snprintf(text_path, sizeof(text_path), "%s.pdn", path);
+  long text_size = write_text(text_path, samples, game_count, indices);
+
+  start = now_seconds();
+  uint64_t plies_read;
+  if (!read_binary(path, samples, game_count, &plies_read)) {
+    fprintf(stderr, "round trip failed\n");
+    return 1;
+  }
+  double read_time = now_seconds() - start;
+
+  printf("binary: %ld bytes, %.1f bytes/game, %.2f bytes/ply\n",
+         binary_size, (double)binary_size / game_count, (double)binary_size / total_plies);
+  printf("text:   %ld bytes, %.1f bytes/game, %.1fx the binary size\n",
+         text_size, (double)text_size / game_count, (double)text_size / binary_size);
+  printf("write:  %.0f games/s, %.1f Mplies/s\n", game_count / write_time, total_plies / write_time / 1e6);
+  printf("read:   %.0f games/s, %.1f Mplies/s, every game matches\n",
+         game_count / read_time, plies_read / read_time / 1e6);
+  free(samples);
+  free(indices);
+  return 0;
+}
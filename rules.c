@@ -0,0 +1,123 @@
+#include "rules.h"
+#include "zobrist.h"
+
+static void game_reset_history(Game *game) {
+  game->ply = 0;
+  game->reversible_plies = 0;
+  game->hashes[0] = game->state.hash;
+  game->result = position_result(&game->state);
+  game->state.is_game_over = game->result != GAME_ONGOING;
+}
+
+void game_start(Game *game) {
+  game_init(&game->state);
+  game_reset_history(game);
+}
+
+bool game_start_fen(Game *game, const char *fen) {
+  game_init(&game->state);
+  if (!game_set_fen(&game->state, fen)) {
+    return false;
+  }
+  game_reset_history(game);
+  return true;
+}
+
+void game_resume(Game *game, const GameState *state, int ply) {
+  game->state = *state;
+  game->state.hash = compute_hash(&game->state);
+  game_reset_history(game);
+  game->ply = ply;
+  game->hashes[ply % GAME_HISTORY_SIZE] = game->state.hash;
+}
+
+GameResult position_result(const GameState *game) {
+  MoveList moves;
+  if (generate_moves(game, &moves) > 0) {
+    return GAME_ONGOING;
+  }
+  return game->current_player == PLAYER_ONE ? GAME_PLAYER_TWO_WINS : GAME_PLAYER_ONE_WINS;
+}
+
+// only positions since the last irreversible move with the same side to
+// move can repeat the current one
+static int repetitions(const Game *game) {
+  int count = 1;
+  for (int back = 2; back <= game->reversible_plies; back += 2) {
+    if (game->hashes[(game->ply - back) % GAME_HISTORY_SIZE] == game->state.hash) {
+      count++;
+    }
+  }
+  return count;
+}
+
+bool game_play(Game *game, const Move *m) {
+  if (game->result != GAME_ONGOING) {
+    return false;
+  }
+  const Player *mover = &game->state.players[game->state.current_player];
+  bool irreversible = is_capture(m) || (mover->men & SQUARE_BIT(m->from));
+  make_move(&game->state, m);
+  game->ply++;
+  game->hashes[game->ply % GAME_HISTORY_SIZE] = game->state.hash;
+  game->reversible_plies = irreversible ? 0 : game->reversible_plies + 1;
+
+  game->result = position_result(&game->state);
+  if (game->result == GAME_ONGOING &&
+      (game->reversible_plies >= DRAW_REVERSIBLE_PLIES ||
+       game->ply >= MAX_GAME_PLIES ||
+       repetitions(game) >= DRAW_REPETITIONS)) {
+    game->result = GAME_DRAW;
+  }
+  game->state.is_game_over = game->result != GAME_ONGOING;
+  return true;
+}
+
+// squares m lands on, the one square of a quiet move included
+static int landings(const Move *m, const uint8_t **path) {
+  *path = is_capture(m) ? m->path : &m->to;
+  return is_capture(m) ? m->jump_count : 1;
+}
+
+// how many of squares m lands on in order, stopping at the first it misses
+static int landed(const Move *m, const int *squares, int count) {
+  const uint8_t *path;
+  int length = landings(m, &path);
+  int matched = 0;
+  for (int i = 0; i < length && matched < count; i++) {
+    matched += path[i] == squares[matched];
+  }
+  return matched;
+}
+
+int find_moves(const MoveList *moves, int from, const int *squares, int count, const Move **move) {
+  int found = 0;
+  *move = NULL;
+  for (int i = 0; i < moves->count; i++) {
+    const Move *m = &moves->moves[i];
+    if (m->from != from || count == 0 || m->to != squares[count - 1] || landed(m, squares, count) != count) {
+      continue;
+    }
+    const uint8_t *path;
+    if (landings(m, &path) == count) {
+      // a shorter path is picked out by its squares alone, a longer one
+      // by naming one of its other landings as well
+      *move = m;
+      return 1;
+    }
+    if (!found++) {
+      *move = m;
+    }
+  }
+  return found;
+}
+
+bool move_continues(const MoveList *moves, int from, const int *squares, int count) {
+  for (int i = 0; i < moves->count; i++) {
+    const Move *m = &moves->moves[i];
+    if (m->from == from && landed(m, squares, count) == count) {
+      return true;
+    }
+  }
+  return false;
+}
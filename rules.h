@@ -0,0 +1,65 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+#include "board.h"
+#include "moves.h"
+
+// 40 moves by each side without a capture or a man moving is a draw
+#define DRAW_REVERSIBLE_PLIES 80
+// the same position with the same side to move for the third time is a draw
+#define DRAW_REPETITIONS 3
+// longer games are cut off as draws so ply counts stay small
+#define MAX_GAME_PLIES 2048
+// a position can only repeat one seen since the last irreversible move,
+// and a game is drawn before more than DRAW_REVERSIBLE_PLIES of those
+#define GAME_HISTORY_SIZE 128
+
+typedef enum GameResult {
+  GAME_ONGOING,
+  GAME_PLAYER_ONE_WINS,
+  GAME_PLAYER_TWO_WINS,
+  GAME_DRAW,
+} GameResult;
+
+// a game in progress: the position plus the history the draw rules need
+// uses no windowing, file or console code so servers and batch jobs
+// can link it on its own
+typedef struct Game {
+  GameState state;
+  // hashes of the latest positions, indexed by ply % GAME_HISTORY_SIZE
+  uint64_t hashes[GAME_HISTORY_SIZE];
+  int ply;
+  // plies since the last capture or man move, earlier positions
+  // can never come back
+  int reversible_plies;
+  GameResult result;
+} Game;
+
+void game_start(Game *game);
+// starts from a PDN FEN position instead of the initial one
+bool game_start_fen(Game *game, const char *fen);
+
+// continues a game from a position received from elsewhere, such as a
+// server, at the given ply, without the history before it
+void game_resume(Game *game, const GameState *state, int ply);
+
+// plays m, which must come from generate_moves on game->state, and
+// updates the result, returns false once the game is already over
+bool game_play(Game *game, const Move *m);
+
+// the result of a position alone: the side to move loses without a move
+GameResult position_result(const GameState *game);
+
+// the legal moves from a square that land on squares in this order, maybe
+// with other landings in between, and end on the last of them: stores the
+// first in *move and returns how many there are, more than one when
+// several capture paths end on the same square and squares does not name
+// a landing that tells them apart, a move landing on exactly squares and
+// nowhere else is the only one found
+int find_moves(const MoveList *moves, int from, const int *squares, int count, const Move **move);
+// whether a legal move from a square lands on squares in this order, so a
+// path entered one square at a time can still become a move
+bool move_continues(const MoveList *moves, int from, const int *squares, int count);
+
+#endif
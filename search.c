@@ -0,0 +1,511 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "search.h"
+#include "egdb.h"
+#include "eval.h"
+
+// how many nodes pass between clock reads
+#define TIME_CHECK_INTERVAL 1023
+
+#define SKIP_TABLE_SIZE 20
+
+// move ordering scores, only captures or only quiet moves are ever
+// generated together so the two never compete
+#define ORDER_TT_MOVE (1 << 30)
+#define ORDER_CAPTURE (1 << 26)
+#define ORDER_KILLER (1 << 24)
+#define KILLER_SLOTS 2
+// history scores are halved once one reaches this, keeping them below the killers
+#define HISTORY_LIMIT (1 << 20)
+
+// late quiet moves are searched this much shallower, base + ln(depth) *
+// ln(move number) / divisor plies, and searched again at full depth if
+// they beat alpha anyway
+#define LMR_BASE 0.5
+#define LMR_DIVISOR 2.0
+// no reductions at shallower nodes or for the first few moves
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 3
+
+static TranspositionTable shared_tt;
+static int reductions[MAX_PLY][MAX_MOVES];
+static pthread_once_t reductions_once = PTHREAD_ONCE_INIT;
+
+// state every thread of one search() call shares
+typedef struct SearchShared {
+  SearchLimits limits;
+  double start_time;
+  // from limits.time_control, timed is false without one
+  bool timed;
+  TimeBudget budget;
+  int max_depth;
+  // positions with at most this many pieces are probed, 0 without a database
+  int egdb_pieces;
+  // raised by the main thread, a limit or search_abort, read by all threads
+  int stop;
+  // node total across threads, flushed every TIME_CHECK_INTERVAL nodes
+  uint64_t nodes;
+} SearchShared;
+
+typedef struct Searcher {
+  GameState game;
+  TranspositionTable *tt;
+  const NnueNetwork *network;
+  SearchShared *shared;
+  int thread_id;
+  uint64_t nodes;
+  uint64_t flushed_nodes;
+  uint64_t egdb_hits;
+  // of nodes, those searched past the nominal depth to finish captures
+  uint64_t quiescence_nodes;
+  bool stopped;
+  // result of the deepest iteration this thread finished
+  int completed_depth;
+  int score;
+  Move best_pv[MAX_PLY];
+  int best_pv_length;
+  // triangular principal variation table
+  Move pv[MAX_PLY][MAX_PLY];
+  int pv_length[MAX_PLY];
+  // network inputs of the position at each ply, only kept with a network
+  NnueAccumulator accumulators[MAX_PLY];
+  // quiet moves that last caused a cutoff at each ply, newest first
+  Move killers[MAX_PLY][KILLER_SLOTS];
+  // how often a quiet move from one square to another caused a cutoff,
+  // weighted by depth, per side to move
+  int history[PLAYER_COUNT][SQUARE_COUNT][SQUARE_COUNT];
+  // nodes that failed high, and of those, on the first move searched
+  uint64_t cutoffs;
+  uint64_t first_move_cutoffs;
+  // nodes of the last two iterations this thread finished
+  uint64_t iteration_nodes[2];
+  // how often the best move changed between iterations lately
+  double instability;
+} Searcher;
+
+// helper threads skip some iterations so they spread over different
+// depths instead of all searching the same tree in lockstep
+static const int skip_size[SKIP_TABLE_SIZE] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int skip_phase[SKIP_TABLE_SIZE] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+static double elapsed_seconds(const SearchShared *shared) {
+  return clock_now(shared->limits.clock) - shared->start_time;
+}
+
+// score of the current position from the point of view of the side to move
+static int static_score(Searcher *s, int ply) {
+  return s->network ? nnue_evaluate(s->network, &s->game, &s->accumulators[ply]) : evaluate(&s->game);
+}
+
+static void check_limits(Searcher *s) {
+  SearchShared *shared = s->shared;
+  if (__atomic_load_n(&shared->stop, __ATOMIC_RELAXED) ||
+      (shared->limits.abort_flag && __atomic_load_n(shared->limits.abort_flag, __ATOMIC_RELAXED))) {
+    s->stopped = true;
+    return;
+  }
+  if ((s->nodes & TIME_CHECK_INTERVAL) != 0) {
+    return;
+  }
+  uint64_t total = __atomic_add_fetch(&shared->nodes, s->nodes - s->flushed_nodes, __ATOMIC_RELAXED);
+  s->flushed_nodes = s->nodes;
+  // only the main thread watches the limits, helpers follow its stop signal
+  if (s->thread_id != 0) {
+    return;
+  }
+  if ((shared->limits.max_nodes && total >= shared->limits.max_nodes) ||
+      (shared->limits.max_time > 0 && elapsed_seconds(shared) >= shared->limits.max_time) ||
+      (shared->timed && elapsed_seconds(shared) >= shared->budget.hard)) {
+    s->stopped = true;
+    __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+  }
+}
+
+void search_abort(int *abort_flag) {
+  __atomic_store_n(abort_flag, 1, __ATOMIC_RELAXED);
+}
+
+bool search_init(size_t hash_megabytes) {
+  tt_free(&shared_tt);
+  return tt_init(&shared_tt, hash_megabytes);
+}
+
+void search_clear_hash(void) {
+  if (shared_tt.buckets) {
+    tt_clear(&shared_tt);
+  }
+}
+
+// win scores are stored relative to the node so they stay valid
+// when the same position is reached at a different ply
+static int score_to_tt(int score, int ply) {
+  if (score >= SCORE_WIN_THRESHOLD) {
+    return score + ply;
+  }
+  if (score <= -SCORE_WIN_THRESHOLD) {
+    return score - ply;
+  }
+  return score;
+}
+
+static int score_from_tt(int score, int ply) {
+  if (score >= SCORE_WIN_THRESHOLD) {
+    return score - ply;
+  }
+  if (score <= -SCORE_WIN_THRESHOLD) {
+    return score + ply;
+  }
+  return score;
+}
+
+// captures are forced and chain, so a position where the side to move
+// has one is not scored until the exchange has played out, there is no
+// standing pat since the side to move cannot decline to capture, and a
+// side left with neither a capture nor a quiet move has lost
+static int quiesce(Searcher *s, int ply, int alpha, int beta) {
+  if (ply >= MAX_PLY - 1) {
+    return static_score(s, ply);
+  }
+  if (!capturing_pieces(&s->game)) {
+    return moving_pieces(&s->game) ? static_score(s, ply) : -SCORE_WIN + ply;
+  }
+  MoveList moves;
+  int count = generate_moves(&s->game, &moves);
+  int best = -SCORE_INFINITE;
+  for (int i = 0; i < count; i++) {
+    const Move *m = &moves.moves[i];
+    if (s->network) {
+      nnue_update(s->network, &s->game, m, &s->accumulators[ply], &s->accumulators[ply + 1]);
+    }
+    make_move(&s->game, m);
+    s->nodes++;
+    s->quiescence_nodes++;
+    check_limits(s);
+    int score = s->stopped ? 0 : -quiesce(s, ply + 1, -beta, -alpha);
+    unmake_move(&s->game, m);
+    if (s->stopped) {
+      return 0;
+    }
+    if (score > best) {
+      best = score;
+      if (score > alpha) {
+        alpha = score;
+      }
+      if (alpha >= beta) {
+        break;
+      }
+    }
+  }
+  return best;
+}
+
+static void init_reductions(void) {
+  for (int depth = 1; depth < MAX_PLY; depth++) {
+    for (int moves = 1; moves < MAX_MOVES; moves++) {
+      reductions[depth][moves] = (int)(LMR_BASE + log(depth) * log(moves) / LMR_DIVISOR);
+    }
+  }
+}
+
+static inline bool same_move(const Move *a, const Move *b) {
+  return a->from == b->from && a->to == b->to && a->captured == b->captured;
+}
+
+static inline bool same_quiet_move(const Move *a, const Move *b) {
+  return a->from == b->from && a->to == b->to;
+}
+
+// the hash move, then captures taking the most pieces and kings, or
+// killers and then quiet moves by history
+static void score_moves(const Searcher *s, const MoveList *moves, int tt_move, int ply, int *scores) {
+  const Move *killers = s->killers[ply];
+  const int(*history)[SQUARE_COUNT] = s->history[s->game.current_player];
+  for (int i = 0; i < moves->count; i++) {
+    const Move *m = &moves->moves[i];
+    if (i == tt_move) {
+      scores[i] = ORDER_TT_MOVE;
+    } else if (is_capture(m)) {
+      scores[i] = ORDER_CAPTURE + 2 * __builtin_popcount(m->captured) + __builtin_popcount(m->captured_kings);
+    } else if (same_quiet_move(m, &killers[0])) {
+      scores[i] = ORDER_KILLER + 1;
+    } else if (same_quiet_move(m, &killers[1])) {
+      scores[i] = ORDER_KILLER;
+    } else {
+      scores[i] = history[m->from][m->to];
+    }
+  }
+}
+
+// index of the best scored move not searched yet, found when needed
+// since most nodes cut off after a move or two
+static int next_move(int *scores, int count) {
+  int best = 0;
+  for (int i = 1; i < count; i++) {
+    if (scores[i] > scores[best]) {
+      best = i;
+    }
+  }
+  scores[best] = -1;
+  return best;
+}
+
+static void record_cutoff(Searcher *s, const Move *m, int depth, int ply) {
+  if (is_capture(m)) {
+    return;
+  }
+  Move *killers = s->killers[ply];
+  if (!same_quiet_move(m, &killers[0])) {
+    killers[1] = killers[0];
+    killers[0] = *m;
+  }
+  int(*history)[SQUARE_COUNT] = s->history[s->game.current_player];
+  history[m->from][m->to] += depth * depth;
+  if (history[m->from][m->to] >= HISTORY_LIMIT) {
+    for (int from = 0; from < SQUARE_COUNT; from++) {
+      for (int to = 0; to < SQUARE_COUNT; to++) {
+        history[from][to] /= 2;
+      }
+    }
+  }
+}
+
+static int negamax(Searcher *s, int depth, int ply, int alpha, int beta) {
+  s->nodes++;
+  s->pv_length[ply] = 0;
+  check_limits(s);
+  if (s->stopped) {
+    return 0;
+  }
+  // the root still needs a move, everywhere else a database value is final
+  if (ply > 0 && __builtin_popcount(occupied_squares(&s->game)) <= s->shared->egdb_pieces) {
+    EgdbValue v = egdb_probe(&s->game);
+    if (v != EGDB_UNKNOWN) {
+      s->egdb_hits++;
+      if (v == EGDB_DRAW) {
+        return 0;
+      }
+      int known = SCORE_KNOWN_WIN - ply;
+      return (v == EGDB_WIN ? known : -known) + static_score(s, ply);
+    }
+  }
+  if (depth <= 0 || ply >= MAX_PLY - 1) {
+    return quiesce(s, ply, alpha, beta);
+  }
+  int alpha_orig = alpha;
+  int tt_move = TT_NO_MOVE;
+  TTHit hit;
+  if (tt_probe(s->tt, s->game.hash, &hit)) {
+    tt_move = hit.move_index;
+    int score = score_from_tt(hit.score, ply);
+    if (ply > 0 && hit.depth >= depth &&
+        (hit.bound == TT_EXACT ||
+         (hit.bound == TT_LOWER && score >= beta) ||
+         (hit.bound == TT_UPPER && score <= alpha))) {
+      return score;
+    }
+  }
+  MoveList moves;
+  int count = generate_moves(&s->game, &moves);
+  if (count == 0) {
+    return -SCORE_WIN + ply;
+  }
+  int order[MAX_MOVES];
+  score_moves(s, &moves, tt_move, ply, order);
+  int best = -SCORE_INFINITE;
+  int best_index = TT_NO_MOVE;
+  for (int i = 0; i < count; i++) {
+    int index = next_move(order, count);
+    const Move *m = &moves.moves[index];
+    if (s->network) {
+      nnue_update(s->network, &s->game, m, &s->accumulators[ply], &s->accumulators[ply + 1]);
+    }
+    make_move(&s->game, m);
+    int score;
+    if (i == 0) {
+      score = -negamax(s, depth - 1, ply + 1, -beta, -alpha);
+    } else {
+      // a quiet move that leaves the opponent a capture starts an
+      // exchange, which is not reduced, nor are killers
+      int reduction = 0;
+      if (depth >= LMR_MIN_DEPTH && i >= LMR_MIN_MOVES && !is_capture(m) && !m->promotes &&
+          !same_quiet_move(m, &s->killers[ply][0]) && !same_quiet_move(m, &s->killers[ply][1]) &&
+          !capturing_pieces(&s->game)) {
+        reduction = reductions[depth][i];
+        if (reduction > depth - 2) {
+          reduction = depth - 2;
+        }
+      }
+      // every move after the first is expected to fail low, which a null
+      // window around alpha shows cheaply, only a move that does not is
+      // searched again, first unreduced and then with the full window
+      score = -negamax(s, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+      if (score > alpha && reduction > 0) {
+        score = -negamax(s, depth - 1, ply + 1, -alpha - 1, -alpha);
+      }
+      if (score > alpha && score < beta) {
+        score = -negamax(s, depth - 1, ply + 1, -beta, -alpha);
+      }
+    }
+    unmake_move(&s->game, m);
+    if (s->stopped) {
+      return 0;
+    }
+    if (score > best) {
+      best = score;
+      if (score > alpha) {
+        best_index = index;
+        alpha = score;
+        s->pv[ply][0] = *m;
+        memcpy(&s->pv[ply][1], s->pv[ply + 1], s->pv_length[ply + 1] * sizeof(Move));
+        s->pv_length[ply] = s->pv_length[ply + 1] + 1;
+      }
+      if (alpha >= beta) {
+        s->cutoffs++;
+        s->first_move_cutoffs += i == 0;
+        record_cutoff(s, m, depth, ply);
+        break;
+      }
+    }
+  }
+  TTBound bound = (best >= beta) ? TT_LOWER : (best > alpha_orig) ? TT_EXACT : TT_UPPER;
+  tt_store(s->tt, s->game.hash, depth, bound, score_to_tt(best, ply), best_index);
+  return best;
+}
+
+static void *iterate(void *arg) {
+  Searcher *s = arg;
+  SearchShared *shared = s->shared;
+  int skip = (s->thread_id - 1) % SKIP_TABLE_SIZE;
+  for (int depth = 1; depth <= shared->max_depth; depth++) {
+    if (s->thread_id > 0 && ((depth + skip_phase[skip]) / skip_size[skip]) % 2 == 1) {
+      continue;
+    }
+    uint64_t nodes_before = s->nodes;
+    int score = negamax(s, depth, 0, -SCORE_INFINITE, SCORE_INFINITE);
+    if (s->stopped) {
+      break;
+    }
+    s->iteration_nodes[0] = s->iteration_nodes[1];
+    s->iteration_nodes[1] = s->nodes - nodes_before;
+    // recent changes of the best move count most, older ones fade
+    bool changed = s->best_pv_length > 0 && s->pv_length[0] > 0 && !same_move(&s->best_pv[0], &s->pv[0][0]);
+    s->instability = s->instability / 2 + changed;
+    s->completed_depth = depth;
+    s->score = score;
+    s->best_pv_length = s->pv_length[0];
+    memcpy(s->best_pv, s->pv[0], s->pv_length[0] * sizeof(Move));
+    // the game tree is solved, deeper iterations cannot change the result
+    if (score >= SCORE_WIN_THRESHOLD || score <= -SCORE_WIN_THRESHOLD) {
+      break;
+    }
+    // an iteration started after the soft deadline would rarely finish
+    // before the hard one, and an unsettled best move earns more time
+    if (s->thread_id == 0 && shared->timed &&
+        elapsed_seconds(shared) >= time_soft_deadline(&shared->budget, s->instability)) {
+      break;
+    }
+  }
+  // helpers are only useful while the main thread is still searching
+  if (s->thread_id == 0) {
+    __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+  }
+  return NULL;
+}
+
+bool search(const GameState *game, SearchLimits limits, SearchResult *result) {
+  memset(result, 0, sizeof(*result));
+  pthread_once(&reductions_once, init_reductions);
+  MoveList root_moves;
+  if (generate_moves(game, &root_moves) == 0) {
+    return false;
+  }
+  int thread_count = limits.threads > 1 ? limits.threads : 1;
+  if (thread_count > MAX_SEARCH_THREADS) {
+    thread_count = MAX_SEARCH_THREADS;
+  }
+  SearchShared shared = {
+    .limits = limits,
+    .start_time = clock_now(limits.clock),
+    .max_depth = limits.max_depth > 0 ? limits.max_depth : MAX_PLY - 1,
+    .egdb_pieces = egdb_max_pieces(),
+  };
+  if (shared.max_depth > MAX_PLY - 1) {
+    shared.max_depth = MAX_PLY - 1;
+  }
+  if (limits.time_control) {
+    shared.timed = true;
+    shared.budget = time_budget(limits.time_control, root_moves.count, is_capture(&root_moves.moves[0]));
+  }
+  Searcher *searchers = calloc(thread_count, sizeof(Searcher));
+  pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+  if (!searchers || !threads) {
+    free(searchers);
+    free(threads);
+    return false;
+  }
+  TranspositionTable *tt = limits.tt ? limits.tt : &shared_tt;
+  tt_new_search(tt);
+  for (int i = 0; i < thread_count; i++) {
+    searchers[i].game = *game;
+    searchers[i].tt = tt;
+    searchers[i].network = limits.network;
+    if (limits.network) {
+      nnue_refresh(limits.network, game, &searchers[i].accumulators[0]);
+    }
+    searchers[i].shared = &shared;
+    searchers[i].thread_id = i;
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, SEARCH_THREAD_STACK);
+  int started = 1;
+  for (int i = 1; i < thread_count; i++) {
+    if (pthread_create(&threads[i], &attr, iterate, &searchers[i]) != 0) {
+      break;
+    }
+    started++;
+  }
+  pthread_attr_destroy(&attr);
+  iterate(&searchers[0]);
+  for (int i = 1; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  // a helper may have finished a deeper iteration than the main thread
+  const Searcher *best = &searchers[0];
+  for (int i = 1; i < started; i++) {
+    if (searchers[i].completed_depth > best->completed_depth) {
+      best = &searchers[i];
+    }
+  }
+  // something to play even if the first iteration is cut short
+  result->best_move = best->best_pv_length > 0 ? best->best_pv[0] : root_moves.moves[0];
+  result->has_move = true;
+  result->score = best->score;
+  result->depth = best->completed_depth;
+  result->pv_length = best->best_pv_length;
+  memcpy(result->pv, best->best_pv, best->best_pv_length * sizeof(Move));
+  for (int i = 0; i < started; i++) {
+    result->nodes += searchers[i].nodes;
+    result->egdb_hits += searchers[i].egdb_hits;
+    result->quiescence_nodes += searchers[i].quiescence_nodes;
+    result->cutoffs += searchers[i].cutoffs;
+    result->first_move_cutoffs += searchers[i].first_move_cutoffs;
+  }
+  // the main thread runs every iteration, helpers skip some
+  if (searchers[0].iteration_nodes[0] > 0) {
+    result->branching_factor = (double)searchers[0].iteration_nodes[1] / searchers[0].iteration_nodes[0];
+  }
+  result->threads = started;
+  result->hashfull = tt_hashfull(tt);
+  result->elapsed = elapsed_seconds(&shared);
+  result->budget = shared.budget;
+  result->nodes_per_second = result->elapsed > 0 ? result->nodes / result->elapsed : 0;
+  free(searchers);
+  free(threads);
+  return true;
+}
@@ -0,0 +1,92 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+#include "board.h"
+#include "moves.h"
+#include "tt.h"
+#include "nnue.h"
+#include "timeman.h"
+
+#define MAX_PLY 64
+#define SCORE_INFINITE 32000
+// a side with no legal moves has lost, scored as -(SCORE_WIN - ply)
+#define SCORE_WIN 30000
+#define SCORE_WIN_THRESHOLD (SCORE_WIN - MAX_PLY)
+// endgame database wins without a known distance, below every win the
+// search proves itself, material is added so captures still make progress
+#define SCORE_KNOWN_WIN 20000
+
+#define MAX_SEARCH_THREADS 256
+// stack size for any thread that calls search, which needs room for a
+// full depth recursion of move lists
+#define SEARCH_THREAD_STACK (8 * 1024 * 1024)
+
+// a zero field means no limit on that axis
+typedef struct SearchLimits {
+  int max_depth;
+  double max_time;
+  uint64_t max_nodes;
+  // lazy smp worker count sharing the transposition table, 0 means 1
+  int threads;
+  // optional flag another thread can raise with search_abort
+  int *abort_flag;
+  // optional table of the caller's own to search with instead of the
+  // shared one, so independent searches can run at the same time
+  TranspositionTable *tt;
+  // optional network to score positions with instead of evaluate
+  const NnueNetwork *network;
+  // optional clock of the side to move, the search then budgets its own
+  // time for the move within max_time
+  const TimeControl *time_control;
+  // optional source of the time for every deadline, the monotonic wall
+  // clock without one
+  const SearchClock *clock;
+} SearchLimits;
+
+typedef struct SearchResult {
+  Move best_move;
+  bool has_move;
+  // from the point of view of the side to move
+  int score;
+  // last fully searched depth
+  int depth;
+  uint64_t nodes;
+  double elapsed;
+  // the deadlines set from limits.time_control, zero without one
+  TimeBudget budget;
+  double nodes_per_second;
+  int threads;
+  // permille of the transposition table used by this search
+  int hashfull;
+  // positions scored by the endgame database
+  uint64_t egdb_hits;
+  // of nodes, those past the nominal depth resolving forced captures
+  uint64_t quiescence_nodes;
+  // nodes of the last finished iteration over those of the one before
+  double branching_factor;
+  // nodes that failed high, and of those, on the first move searched,
+  // the share of the second measures the move ordering
+  uint64_t cutoffs;
+  uint64_t first_move_cutoffs;
+  Move pv[MAX_PLY];
+  int pv_length;
+} SearchResult;
+
+#define DEFAULT_HASH_MB 64
+
+// allocates the transposition table shared by every search
+// without it search still works but caches nothing
+bool search_init(size_t hash_megabytes);
+// forgets everything learned so far, e.g. for a new game
+void search_clear_hash(void);
+
+// iterative deepening negamax alpha-beta from game, run on limits.threads
+// threads over the shared transposition table
+// returns false when the side to move has no legal move
+bool search(const GameState *game, SearchLimits limits, SearchResult *result);
+// makes the search watching abort_flag return as soon as possible,
+// it still reports the best move of its last finished iteration
+void search_abort(int *abort_flag);
+
+#endif
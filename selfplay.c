@@ -0,0 +1,463 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+#include "search.h"
+#include "tt.h"
+#include "egdb.h"
+#include "book.h"
+#include "nnue.h"
+#include "record.h"
+#include "pdn.h"
+#include "timeman.h"
+
+#define DEFAULT_GAMES 1000
+#define DEFAULT_STATS "selfplay.txt"
+#define DEFAULT_ENGINE_NODES 20000
+#define DEFAULT_ENGINE_HASH_MB 16
+#define MAX_OPENINGS 4096
+// generated openings are every position this many plies in whose
+// score at OPENING_CHECK_DEPTH is within OPENING_MAX_SCORE of even
+#define OPENING_PLIES 3
+#define OPENING_CHECK_DEPTH 10
+#define OPENING_MAX_SCORE 40
+
+// how one side plays, parsed from "nodes=20000,depth=8,time=0.1,hash=16,book=book.ckb,nnue=network.nnue",
+// or with "tc=60+0.5" on a clock of 60 s plus 0.5 s a move
+typedef struct EngineConfig {
+  char spec[256];
+  int max_depth;
+  uint64_t max_nodes;
+  double max_time;
+  size_t hash_mb;
+  Book book;
+  bool has_book;
+  NnueNetwork network;
+  bool has_network;
+  // clock at the start of a game, remaining zero without one
+  TimeControl time_control;
+} EngineConfig;
+
+typedef struct Sprt {
+  double elo0;
+  double elo1;
+  double alpha;
+  double beta;
+} Sprt;
+
+// everything the workers share, guarded by lock
+typedef struct Match {
+  EngineConfig engines[2];
+  GameState openings[MAX_OPENINGS];
+  int opening_count;
+  int total_games;
+  Sprt sprt;
+  pthread_mutex_t lock;
+  int next_game;
+  int finished;
+  bool stop;
+  // from the first engine's point of view
+  int wins;
+  int draws;
+  int losses;
+  double llr;
+  const char *decision;
+  // per opening, the first engine's points out of its two games
+  double *opening_points;
+  int *opening_games;
+  RecordWriter record;
+  bool recording;
+  // rewritten after every game so a long match can be followed
+  const char *stats_path;
+  double start_time;
+} Match;
+
+static bool parse_engine(EngineConfig *e, const char *spec) {
+  snprintf(e->spec, sizeof(e->spec), "%s", spec);
+  e->max_nodes = DEFAULT_ENGINE_NODES;
+  e->hash_mb = DEFAULT_ENGINE_HASH_MB;
+  bool nodes_set = false;
+  char copy[256];
+  snprintf(copy, sizeof(copy), "%s", spec);
+  for (char *field = strtok(copy, ","); field; field = strtok(NULL, ",")) {
+    char *value = strchr(field, '=');
+    if (!value) {
+      return false;
+    }
+    *value++ = '\0';
+    if (strcmp(field, "depth") == 0) {
+      e->max_depth = atoi(value);
+    } else if (strcmp(field, "nodes") == 0) {
+      e->max_nodes = strtoull(value, NULL, 10);
+      nodes_set = true;
+    } else if (strcmp(field, "time") == 0) {
+      e->max_time = atof(value);
+    } else if (strcmp(field, "hash") == 0) {
+      e->hash_mb = strtoul(value, NULL, 10);
+    } else if (strcmp(field, "book") == 0) {
+      e->has_book = book_open(&e->book, value);
+      if (!e->has_book) {
+        return false;
+      }
+    } else if (strcmp(field, "tc") == 0) {
+      char *increment = strchr(value, '+');
+      e->time_control.remaining = atof(value);
+      e->time_control.increment = increment ? atof(increment + 1) : 0;
+      if (e->time_control.remaining <= 0) {
+        return false;
+      }
+    } else if (strcmp(field, "nnue") == 0) {
+      e->has_network = nnue_open(&e->network, value);
+      if (!e->has_network) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  // on a clock the search budgets itself unless a node limit is asked for too
+  if (e->time_control.remaining > 0 && !nodes_set) {
+    e->max_nodes = 0;
+  }
+  return true;
+}
+
+// every position OPENING_PLIES in that a short search calls close to
+// even, so neither colour starts out won
+static void add_openings(Match *match, GameState *position, int plies_left) {
+  if (plies_left == 0) {
+    for (int i = 0; i < match->opening_count; i++) {
+      if (same_position(&match->openings[i], position)) {
+        return;
+      }
+    }
+    SearchLimits limits = {.max_depth = OPENING_CHECK_DEPTH};
+    SearchResult result;
+    if (match->opening_count < MAX_OPENINGS && search(position, limits, &result) &&
+        abs(result.score) <= OPENING_MAX_SCORE) {
+      match->openings[match->opening_count++] = *position;
+    }
+    return;
+  }
+  MoveList moves;
+  int count = generate_moves(position, &moves);
+  for (int i = 0; i < count; i++) {
+    make_move(position, &moves.moves[i]);
+    add_openings(match, position, plies_left - 1);
+    unmake_move(position, &moves.moves[i]);
+  }
+}
+
+static void on_opening(void *user, const PdnGame *game) {
+  Match *match = user;
+  if (game->valid && match->opening_count < MAX_OPENINGS) {
+    match->openings[match->opening_count++] = game->position;
+  }
+}
+
+// the log likelihood ratio of elo1 against elo0 for the results so far,
+// using the normal approximation of the score distribution
+static double sprt_llr(const Sprt *sprt, int wins, int draws, int losses) {
+  int n = wins + draws + losses;
+  if (n == 0) {
+    return 0;
+  }
+  double score = (wins + draws * 0.5) / n;
+  double variance = (wins * pow(1 - score, 2) + draws * pow(0.5 - score, 2) + losses * pow(score, 2)) / n;
+  // identical results so far say nothing about the spread
+  if (variance == 0) {
+    return 0;
+  }
+  double s0 = 1 / (1 + pow(10, -sprt->elo0 / 400));
+  double s1 = 1 / (1 + pow(10, -sprt->elo1 / 400));
+  return n * (s1 - s0) * (2 * score - s0 - s1) / (2 * variance);
+}
+
+static double elo_of(double score) {
+  if (score <= 0 || score >= 1) {
+    return score <= 0 ? -INFINITY : INFINITY;
+  }
+  return -400 * log10(1 / score - 1);
+}
+
+// clock is the engine's own in this game, NULL when it plays without one
+static Move engine_move(const EngineConfig *e, TranspositionTable *tt, const GameState *position,
+                        const TimeControl *clock) {
+  BookMove book_moves[BOOK_MAX_MOVES];
+  if (e->has_book && book_probe(&e->book, position, book_moves, BOOK_MAX_MOVES) > 0) {
+    return book_moves[0].move;
+  }
+  SearchLimits limits = {
+    .max_depth = e->max_depth,
+    .max_nodes = e->max_nodes,
+    .max_time = e->max_time,
+    .threads = 1,
+    .tt = tt,
+    .network = e->has_network ? &e->network : NULL,
+    .time_control = clock,
+  };
+  SearchResult result;
+  search(position, limits, &result);
+  return result.best_move;
+}
+
+// plays one game from opening, black_engine is the engine playing black,
+// each engine keeps its own table so neither sees what the other found
+static GameResult play_game(Match *match, TranspositionTable *tts, const GameState *opening, int black_engine,
+                            Move *moves, int *ply_count) {
+  Game game;
+  game_resume(&game, opening, 0);
+  TimeControl clocks[2];
+  for (int i = 0; i < 2; i++) {
+    tt_clear(&tts[i]);
+    clocks[i] = match->engines[i].time_control;
+  }
+  while (game.result == GAME_ONGOING) {
+    int engine = game.state.current_player == PLAYER_TWO ? black_engine : 1 - black_engine;
+    TimeControl *clock = clocks[engine].remaining > 0 ? &clocks[engine] : NULL;
+    double start = now_seconds();
+    moves[game.ply] = engine_move(&match->engines[engine], &tts[engine], &game.state, clock);
+    if (clock) {
+      clock->remaining -= now_seconds() - start;
+      // flagged, the game is lost on time
+      if (clock->remaining <= 0) {
+        game.result = game.state.current_player == PLAYER_TWO ? GAME_PLAYER_ONE_WINS : GAME_PLAYER_TWO_WINS;
+        break;
+      }
+      clock->remaining += clock->increment;
+    }
+    game_play(&game, &moves[game.ply]);
+  }
+  *ply_count = game.ply;
+  return game.result;
+}
+
+static void record_game(Match *match, const GameState *opening, const Move *moves, int ply_count, GameResult result) {
+  record_begin_game(&match->record, opening);
+  for (int i = 0; i < ply_count; i++) {
+    record_add_move(&match->record, &moves[i]);
+  }
+  record_end_game(&match->record, result);
+}
+
+static bool write_stats(const Match *match, const char *path, double elapsed) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    return false;
+  }
+  int n = match->wins + match->draws + match->losses;
+  double score = n ? (match->wins + match->draws * 0.5) / n : 0.5;
+  double variance = n ? (match->wins * pow(1 - score, 2) + match->draws * pow(0.5 - score, 2) +
+                         match->losses * pow(score, 2)) / n : 0;
+  double margin = n ? 1.96 * sqrt(variance / n) : 0;
+  fprintf(f, "first engine:  %s\n", match->engines[0].spec);
+  fprintf(f, "second engine: %s\n", match->engines[1].spec);
+  fprintf(f, "games: %d of %d, %d openings, %.1f s\n", n, match->total_games, match->opening_count, elapsed);
+  fprintf(f, "first engine: +%d =%d -%d, score %.4f, elo %.1f (%.1f to %.1f)\n", match->wins, match->draws,
+          match->losses, score, elo_of(score), elo_of(score - margin), elo_of(score + margin));
+  fprintf(f, "sprt: elo0 %.1f, elo1 %.1f, alpha %.3f, beta %.3f, llr %.3f, %s\n", match->sprt.elo0,
+          match->sprt.elo1, match->sprt.alpha, match->sprt.beta, match->llr,
+          match->decision ? match->decision : "no decision");
+  fprintf(f, "\nopening  games  first engine points  fen\n");
+  for (int i = 0; i < match->opening_count; i++) {
+    if (!match->opening_games[i]) {
+      continue;
+    }
+    char fen[PDN_MAX_FEN];
+    game_format_fen(&match->openings[i], fen, sizeof(fen));
+    fprintf(f, "%7d  %5d  %19.1f  %s\n", i + 1, match->opening_games[i], match->opening_points[i], fen);
+  }
+  return fclose(f) == 0;
+}
+
+static void *worker(void *arg) {
+  Match *match = arg;
+  TranspositionTable tts[2] = {{0}};
+  for (int i = 0; i < 2; i++) {
+    tt_init(&tts[i], match->engines[i].hash_mb);
+  }
+  Move moves[MAX_GAME_PLIES];
+  for (;;) {
+    pthread_mutex_lock(&match->lock);
+    int index = match->next_game;
+    bool done = match->stop || index >= match->total_games;
+    match->next_game += !done;
+    pthread_mutex_unlock(&match->lock);
+    if (done) {
+      break;
+    }
+    // each opening is played twice in a row with the colours swapped
+    int opening = (index / 2) % match->opening_count;
+    int black_engine = index % 2;
+    int ply_count;
+    GameResult result = play_game(match, tts, &match->openings[opening], black_engine, moves, &ply_count);
+
+    GameResult first_wins = black_engine == 0 ? GAME_PLAYER_TWO_WINS : GAME_PLAYER_ONE_WINS;
+    double points = result == GAME_DRAW ? 0.5 : result == first_wins ? 1 : 0;
+    pthread_mutex_lock(&match->lock);
+    match->wins += points == 1;
+    match->draws += points == 0.5;
+    match->losses += points == 0;
+    match->opening_points[opening] += points;
+    match->opening_games[opening]++;
+    match->finished++;
+    if (match->recording) {
+      record_game(match, &match->openings[opening], moves, ply_count, result);
+    }
+    match->llr = sprt_llr(&match->sprt, match->wins, match->draws, match->losses);
+    double lower = log(match->sprt.beta / (1 - match->sprt.alpha));
+    double upper = log((1 - match->sprt.beta) / match->sprt.alpha);
+    if (!match->decision && match->llr >= upper) {
+      match->decision = "H1 accepted";
+      match->stop = true;
+    } else if (!match->decision && match->llr <= lower) {
+      match->decision = "H0 accepted";
+      match->stop = true;
+    }
+    write_stats(match, match->stats_path, now_seconds() - match->start_time);
+    printf("game %d: opening %d, first engine %s, %d plies, +%d =%d -%d, llr %.2f (%.2f, %.2f)\n",
+           index + 1, opening + 1, black_engine == 0 ? "black" : "red", ply_count, match->wins,
+           match->draws, match->losses, match->llr, lower, upper);
+    fflush(stdout);
+    pthread_mutex_unlock(&match->lock);
+  }
+  for (int i = 0; i < 2; i++) {
+    tt_free(&tts[i]);
+  }
+  return NULL;
+}
+
+// selfplay [--first spec] [--second spec] [--games N] [--concurrency M]
+//          [--openings file.pdn] [--stats file] [--record file.ckr] [--egdb dir]
+//          [--elo0 E] [--elo1 E] [--alpha A] [--beta B]
+// plays the first engine configuration against the second until the
+// games run out or the sequential probability ratio test decides
+int main(int argc, char **argv) {
+  static Match match = {
+    .total_games = DEFAULT_GAMES,
+    .sprt = {.elo0 = 0, .elo1 = 10, .alpha = 0.05, .beta = 0.05},
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .stats_path = DEFAULT_STATS,
+  };
+  const char *specs[2] = {"nodes=20000", "nodes=20000"};
+  int concurrency = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *openings_path = NULL;
+  const char *record_path = NULL;
+  const char *egdb_dir = NULL;
+  bool usage = false;
+  for (int i = 1; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--first") == 0 && has_value) {
+      specs[0] = argv[++i];
+    } else if (strcmp(argv[i], "--second") == 0 && has_value) {
+      specs[1] = argv[++i];
+    } else if (strcmp(argv[i], "--games") == 0 && has_value) {
+      match.total_games = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--concurrency") == 0 && has_value) {
+      concurrency = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--openings") == 0 && has_value) {
+      openings_path = argv[++i];
+    } else if (strcmp(argv[i], "--stats") == 0 && has_value) {
+      match.stats_path = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && has_value) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--egdb") == 0 && has_value) {
+      egdb_dir = argv[++i];
+    } else if (strcmp(argv[i], "--elo0") == 0 && has_value) {
+      match.sprt.elo0 = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--elo1") == 0 && has_value) {
+      match.sprt.elo1 = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--alpha") == 0 && has_value) {
+      match.sprt.alpha = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--beta") == 0 && has_value) {
+      match.sprt.beta = atof(argv[++i]);
+    } else {
+      usage = true;
+    }
+  }
+  for (int i = 0; i < 2 && !usage; i++) {
+    if (!parse_engine(&match.engines[i], specs[i])) {
+      fprintf(stderr, "invalid engine %s\n", specs[i]);
+      usage = true;
+    }
+  }
+  if (usage || match.total_games < 1 || concurrency < 1 || match.sprt.elo1 <= match.sprt.elo0 ||
+      match.sprt.alpha <= 0 || match.sprt.beta <= 0) {
+    fprintf(stderr, "usage: %s [--first spec] [--second spec] [--games N] [--concurrency M]\n"
+                    "       [--openings file.pdn] [--stats file] [--record file.ckr] [--egdb dir]\n"
+                    "       [--elo0 E] [--elo1 E] [--alpha A] [--beta B]\n"
+                    "spec: nodes=N,depth=N,time=S,hash=MB,book=file,nnue=file,tc=S+S\n", argv[0]);
+    return 2;
+  }
+  if (egdb_dir && egdb_open(egdb_dir) > 0) {
+    printf("endgame database complete up to %d pieces\n", egdb_max_pieces());
+  }
+  // the opening check searches with the shared table
+  search_init(DEFAULT_HASH_MB);
+  if (openings_path) {
+    PdnHandlers handlers = {.on_game = on_opening, .user = &match};
+    PdnStats stats = {0};
+    if (!pdn_parse_file(openings_path, 1, &handlers, &stats)) {
+      fprintf(stderr, "could not read %s\n", openings_path);
+      return 1;
+    }
+  } else {
+    GameState start;
+    game_init(&start);
+    add_openings(&match, &start, OPENING_PLIES);
+  }
+  if (match.opening_count == 0) {
+    fprintf(stderr, "no openings to play\n");
+    return 1;
+  }
+  match.opening_points = calloc(match.opening_count, sizeof(double));
+  match.opening_games = calloc(match.opening_count, sizeof(int));
+  if (record_path) {
+    match.recording = record_writer_open(&match.record, record_path);
+    if (!match.recording) {
+      fprintf(stderr, "could not write %s\n", record_path);
+      return 1;
+    }
+  }
+  printf("%s against %s, %d openings, up to %d games on %d threads\n", specs[0], specs[1],
+         match.opening_count, match.total_games, concurrency);
+
+  match.start_time = now_seconds();
+  pthread_t *threads = calloc(concurrency, sizeof(pthread_t));
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, SEARCH_THREAD_STACK);
+  int started = 0;
+  for (; started < concurrency; started++) {
+    if (pthread_create(&threads[started], &attr, worker, &match) != 0) {
+      break;
+    }
+  }
+  pthread_attr_destroy(&attr);
+  if (started == 0) {
+    worker(&match);
+  }
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  double elapsed = now_seconds() - match.start_time;
+  if (match.recording) {
+    record_writer_close(&match.record);
+  }
+  if (!write_stats(&match, match.stats_path, elapsed)) {
+    fprintf(stderr, "could not write %s\n", match.stats_path);
+    return 1;
+  }
+  printf("+%d =%d -%d, llr %.2f, %s, %.1f games/s, stats in %s\n", match.wins, match.draws, match.losses,
+         match.llr, match.decision ? match.decision : "no decision", match.finished / elapsed, match.stats_path);
+  free(threads);
+  free(match.opening_points);
+  free(match.opening_games);
+  return 0;
+}
@@ -0,0 +1,753 @@
+#define _POSIX_C_SOURCE 200809L
+// SO_REUSEPORT and kqueue are outside POSIX
+#define _DEFAULT_SOURCE
+#ifdef __APPLE__
+#define _DARWIN_C_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <sys/event.h>
+#endif
+#include "board.h"
+#include "moves.h"
+#include "rules.h"
+#include "protocol.h"
+
+#define MAX_LOOPS 64
+#define MAX_EVENTS 256
+#define LISTEN_BACKLOG 1024
+#define READ_BUFFER_SIZE 16384
+// a client that stops reading is dropped once this much output is queued
+#define MAX_PENDING_OUTPUT (1 << 20)
+// game ids hold the slot in the low bits, the index of the loop that owns
+// the game above it and a reuse counter in the rest, so an id of a finished
+// game never reaches the next game in its slot
+#define GAME_SLOT_BITS 20
+#define MAX_GAMES (1 << GAME_SLOT_BITS)
+#define INITIAL_GAMES 1024
+#define POLL_TIMEOUT_MS 1000
+#define STATS_INTERVAL 5
+
+typedef struct Connection {
+  int fd;
+  uint8_t in[READ_BUFFER_SIZE];
+  size_t in_length;
+  uint8_t *out;
+  size_t out_length;
+  size_t out_capacity;
+  bool want_write;
+  // closed once the current batch of events is handled, other events
+  // of the batch may still point at the connection
+  bool closing;
+  struct Connection *next_closing;
+  // output was queued while handling some connection's input
+  bool flush_queued;
+  struct Connection *next_flush;
+  // games holding a seat for this connection
+  int game_count;
+  // the loop this connection moves to once the current batch is handled
+  struct Loop *moving_to;
+  struct Connection *next_moving;
+} Connection;
+
+typedef struct ServerGame {
+  Game game;
+  Connection *seats[PLAYER_COUNT];
+  uint32_t serial;
+  bool in_use;
+  int next_free;
+} ServerGame;
+
+// one single threaded event loop with its own listening socket and games
+typedef struct Loop {
+  int index;
+  int listen_fd;
+  int poll_fd;
+  // written by other loops to hand over connections, read end first,
+  // the same eventfd twice on Linux
+  int wake_fds[2];
+  pthread_mutex_t arrivals_lock;
+  Connection *arrivals;
+  ServerGame *games;
+  int game_capacity;
+  int game_count;
+  int free_games;
+  Connection *closing;
+  Connection *flush;
+  Connection *moving;
+  // updated atomically, the stats printer on the main thread reads them
+  uint64_t connections;
+  uint64_t live_games;
+  uint64_t games_started;
+  uint64_t moves;
+} Loop;
+
+static int listen_marker;
+#define LISTENER (&listen_marker)
+static int wake_marker;
+#define WAKER (&wake_marker)
+
+static Loop loops[MAX_LOOPS];
+static int loop_count;
+// bits of a game id that name its loop, none with a single loop
+static int loop_bits;
+
+// minimal readiness poller, epoll on Linux and kqueue elsewhere
+#ifdef __linux__
+typedef struct epoll_event PollEvent;
+
+static int poller_create(void) {
+  return epoll_create1(0);
+}
+
+static bool poller_add(int poll_fd, int fd, void *data) {
+  struct epoll_event ev = {.events = EPOLLIN, .data.ptr = data};
+  return epoll_ctl(poll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+static void poller_want_write(int poll_fd, int fd, void *data, bool want) {
+  struct epoll_event ev = {.events = EPOLLIN | (want ? EPOLLOUT : 0), .data.ptr = data};
+  epoll_ctl(poll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+static void poller_remove(int poll_fd, int fd) {
+  epoll_ctl(poll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+static bool waker_create(int fds[2]) {
+  fds[0] = fds[1] = eventfd(0, EFD_NONBLOCK);
+  return fds[0] >= 0;
+}
+
+static int poller_wait(int poll_fd, PollEvent *events, int max, int timeout_ms) {
+  return epoll_wait(poll_fd, events, max, timeout_ms);
+}
+
+static void *event_data(const PollEvent *e) {
+  return e->data.ptr;
+}
+
+static bool event_readable(const PollEvent *e) {
+  return e->events & (EPOLLIN | EPOLLHUP | EPOLLERR);
+}
+
+static bool event_writable(const PollEvent *e) {
+  return e->events & EPOLLOUT;
+}
+#else
+typedef struct kevent PollEvent;
+
+static int poller_create(void) {
+  return kqueue();
+}
+
+static bool poller_add(int poll_fd, int fd, void *data) {
+  struct kevent ev[2];
+  EV_SET(&ev[0], fd, EVFILT_READ, EV_ADD, 0, 0, data);
+  EV_SET(&ev[1], fd, EVFILT_WRITE, EV_ADD | EV_DISABLE, 0, 0, data);
+  return kevent(poll_fd, ev, 2, NULL, 0, NULL) == 0;
+}
+
+static void poller_want_write(int poll_fd, int fd, void *data, bool want) {
+  struct kevent ev;
+  EV_SET(&ev, fd, EVFILT_WRITE, want ? EV_ENABLE : EV_DISABLE, 0, 0, data);
+  kevent(poll_fd, &ev, 1, NULL, 0, NULL);
+}
+
+static void poller_remove(int poll_fd, int fd) {
+  struct kevent ev[2];
+  EV_SET(&ev[0], fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+  EV_SET(&ev[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+  kevent(poll_fd, ev, 2, NULL, 0, NULL);
+}
+
+static bool set_nonblocking(int fd);
+
+// a socket pair rather than a pipe, poller_add registers a write filter too
+static bool waker_create(int fds[2]) {
+  return socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0 && set_nonblocking(fds[0]) && set_nonblocking(fds[1]);
+}
+
+static int poller_wait(int poll_fd, PollEvent *events, int max, int timeout_ms) {
+  struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+  return kevent(poll_fd, NULL, 0, events, max, &timeout);
+}
+
+static void *event_data(const PollEvent *e) {
+  return e->udata;
+}
+
+static bool event_readable(const PollEvent *e) {
+  return e->filter == EVFILT_READ;
+}
+
+static bool event_writable(const PollEvent *e) {
+  return e->filter == EVFILT_WRITE;
+}
+#endif
+
+static bool set_nonblocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// an eventfd takes any 8 byte write, a socket any write at all, and a
+// full one already wakes the loop
+static void waker_signal(Loop *loop) {
+  uint64_t one = 1;
+  ssize_t n = write(loop->wake_fds[1], &one, sizeof(one));
+  (void)n;
+}
+
+static void waker_drain(Loop *loop) {
+  uint64_t buf[64];
+  while (read(loop->wake_fds[0], buf, sizeof(buf)) > 0) {
+  }
+}
+
+static int open_listener(int port, bool reuse_port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  // every loop binds the same port and the kernel spreads connections
+  if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+    close(fd);
+    return -1;
+  }
+  struct sockaddr_in addr = {
+    .sin_family = AF_INET,
+    .sin_port = htons(port),
+    .sin_addr.s_addr = htonl(INADDR_ANY),
+  };
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, LISTEN_BACKLOG) != 0 || !set_nonblocking(fd)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static inline void count(uint64_t *counter, int64_t delta) {
+  __atomic_add_fetch(counter, delta, __ATOMIC_RELAXED);
+}
+
+static void close_later(Loop *loop, Connection *c) {
+  if (!c->closing) {
+    c->closing = true;
+    c->next_closing = loop->closing;
+    loop->closing = c;
+  }
+}
+
+static void flush_output(Loop *loop, Connection *c) {
+  size_t sent = 0;
+  while (sent < c->out_length) {
+    ssize_t n = write(c->fd, c->out + sent, c->out_length - sent);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        close_later(loop, c);
+      }
+      break;
+    }
+    sent += n;
+  }
+  memmove(c->out, c->out + sent, c->out_length - sent);
+  c->out_length -= sent;
+  bool want_write = c->out_length > 0;
+  if (want_write != c->want_write) {
+    c->want_write = want_write;
+    poller_want_write(loop->poll_fd, c->fd, c, want_write);
+  }
+}
+
+// queues m for c, written out once the current batch of input is handled
+static void send_message(Loop *loop, Connection *c, const Message *m) {
+  if (c->closing) {
+    return;
+  }
+  if (c->out_capacity - c->out_length < PROTOCOL_MAX_MESSAGE) {
+    size_t capacity = c->out_capacity ? c->out_capacity * 2 : 4096;
+    uint8_t *out = capacity <= MAX_PENDING_OUTPUT ? realloc(c->out, capacity) : NULL;
+    if (!out) {
+      close_later(loop, c);
+      return;
+    }
+    c->out = out;
+    c->out_capacity = capacity;
+  }
+  c->out_length += message_encode(m, c->out + c->out_length, c->out_capacity - c->out_length);
+  // one write per connection and batch, however many messages it gets
+  if (!c->flush_queued && !c->want_write) {
+    c->flush_queued = true;
+    c->next_flush = loop->flush;
+    loop->flush = c;
+  }
+}
+
+static void send_error(Loop *loop, Connection *c, uint32_t game_id, ProtocolError error) {
+  Message m = {.type = MSG_ERROR, .game_id = game_id, .error = error};
+  send_message(loop, c, &m);
+}
+
+static uint32_t game_id_of(const Loop *loop, const ServerGame *g) {
+  return (g->serial << (GAME_SLOT_BITS + loop_bits)) | ((uint32_t)loop->index << GAME_SLOT_BITS) |
+         (uint32_t)(g - loop->games);
+}
+
+// the loop a game id belongs to, whether or not the game still exists,
+// NULL when no loop has that index
+static Loop *owner_of(uint32_t game_id) {
+  int index = (game_id >> GAME_SLOT_BITS) & ((1u << loop_bits) - 1);
+  return index < loop_count ? &loops[index] : NULL;
+}
+
+static ServerGame *find_game(Loop *loop, uint32_t game_id) {
+  uint32_t slot = game_id & (MAX_GAMES - 1);
+  if (owner_of(game_id) != loop || slot >= (uint32_t)loop->game_count) {
+    return NULL;
+  }
+  ServerGame *g = &loop->games[slot];
+  return (g->in_use && game_id_of(loop, g) == game_id) ? g : NULL;
+}
+
+static ServerGame *allocate_game(Loop *loop) {
+  if (loop->free_games < 0) {
+    if (loop->game_count == loop->game_capacity) {
+      int capacity = loop->game_capacity ? loop->game_capacity * 2 : INITIAL_GAMES;
+      if (capacity > MAX_GAMES) {
+        return NULL;
+      }
+      ServerGame *games = realloc(loop->games, capacity * sizeof(ServerGame));
+      if (!games) {
+        return NULL;
+      }
+      loop->games = games;
+      loop->game_capacity = capacity;
+    }
+    ServerGame *g = &loop->games[loop->game_count++];
+    g->serial = 0;
+    g->in_use = false;
+    g->next_free = loop->free_games;
+    loop->free_games = g - loop->games;
+  }
+  ServerGame *g = &loop->games[loop->free_games];
+  loop->free_games = g->next_free;
+  g->in_use = true;
+  g->serial = (g->serial + 1) & ((1u << (32 - GAME_SLOT_BITS - loop_bits)) - 1);
+  g->seats[PLAYER_ONE] = g->seats[PLAYER_TWO] = NULL;
+  count(&loop->live_games, 1);
+  return g;
+}
+
+static void free_game(Loop *loop, ServerGame *g) {
+  g->in_use = false;
+  g->next_free = loop->free_games;
+  loop->free_games = g - loop->games;
+  count(&loop->live_games, -1);
+}
+
+// gives up c's seats in g, a game nobody sits at is gone
+static void leave_game(Loop *loop, ServerGame *g, Connection *c) {
+  bool seated = false;
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    if (g->seats[i] == c) {
+      g->seats[i] = NULL;
+      seated = true;
+    }
+  }
+  if (seated) {
+    c->game_count--;
+  }
+  if (!g->seats[PLAYER_ONE] && !g->seats[PLAYER_TWO]) {
+    free_game(loop, g);
+  }
+}
+
+// the seats bits not already held by c must be free
+static bool take_seats(ServerGame *g, Connection *c, uint8_t seats) {
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    if ((seats & (1 << i)) && g->seats[i] && g->seats[i] != c) {
+      return false;
+    }
+  }
+  if (g->seats[PLAYER_ONE] != c && g->seats[PLAYER_TWO] != c) {
+    c->game_count++;
+  }
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    if (seats & (1 << i)) {
+      g->seats[i] = c;
+    }
+  }
+  return true;
+}
+
+static void send_state(Loop *loop, Connection *c, ServerGame *g) {
+  const GameState *state = &g->game.state;
+  Message m = {
+    .type = MSG_STATE,
+    .game_id = game_id_of(loop, g),
+    .ply = g->game.ply,
+    .current_player = state->current_player,
+    .result = g->game.result,
+  };
+  for (int i = 0; i < PLAYER_COUNT; i++) {
+    m.men[i] = state->players[i].men;
+    m.kings[i] = state->players[i].kings;
+  }
+  send_message(loop, c, &m);
+}
+
+static void handle_new_game(Loop *loop, Connection *c, const Message *m) {
+  ServerGame *g = allocate_game(loop);
+  if (!g) {
+    send_error(loop, c, 0, ERR_SERVER_FULL);
+    return;
+  }
+  bool valid = true;
+  if (m->fen[0]) {
+    valid = game_start_fen(&g->game, m->fen);
+  } else {
+    game_start(&g->game);
+  }
+  if (!valid) {
+    free_game(loop, g);
+    send_error(loop, c, 0, ERR_BAD_FEN);
+    return;
+  }
+  take_seats(g, c, m->seats);
+  count(&loop->games_started, 1);
+  send_state(loop, c, g);
+}
+
+static void handle_move(Loop *loop, Connection *c, ServerGame *g, const Message *m) {
+  uint32_t game_id = game_id_of(loop, g);
+  GameState *state = &g->game.state;
+  if (g->game.result != GAME_ONGOING) {
+    send_error(loop, c, game_id, ERR_GAME_OVER);
+    return;
+  }
+  if (g->seats[state->current_player] != c) {
+    send_error(loop, c, game_id, ERR_NOT_YOUR_TURN);
+    return;
+  }
+  MoveList moves;
+  generate_moves(state, &moves);
+  const Move *move = find_wire_move(&moves, &m->move);
+  if (!move) {
+    send_error(loop, c, game_id, ERR_ILLEGAL_MOVE);
+    return;
+  }
+  game_play(&g->game, move);
+  count(&loop->moves, 1);
+  // only what changed goes out, clients apply it to their own copy
+  Message moved = {
+    .type = MSG_MOVED,
+    .game_id = game_id,
+    .ply = g->game.ply,
+    .move = m->move,
+    .captured = move->captured,
+    .promotes = move->promotes,
+    .result = g->game.result,
+  };
+  send_message(loop, g->seats[PLAYER_ONE] ? g->seats[PLAYER_ONE] : g->seats[PLAYER_TWO], &moved);
+  if (g->seats[PLAYER_ONE] && g->seats[PLAYER_TWO] && g->seats[PLAYER_ONE] != g->seats[PLAYER_TWO]) {
+    send_message(loop, g->seats[PLAYER_TWO], &moved);
+  }
+}
+
+static void handle_message(Loop *loop, Connection *c, const Message *m) {
+  if (m->type == MSG_NEW_GAME) {
+    handle_new_game(loop, c, m);
+    return;
+  }
+  ServerGame *g = find_game(loop, m->game_id);
+  if (!g) {
+    send_error(loop, c, m->game_id, ERR_UNKNOWN_GAME);
+    return;
+  }
+  switch (m->type) {
+  case MSG_JOIN:
+    if (take_seats(g, c, m->seats)) {
+      send_state(loop, c, g);
+    } else {
+      send_error(loop, c, m->game_id, ERR_SEAT_TAKEN);
+    }
+    break;
+  case MSG_MOVE:
+    handle_move(loop, c, g, m);
+    break;
+  case MSG_LEAVE:
+    leave_game(loop, g, c);
+    break;
+  default:
+    // server messages sent by a client
+    send_error(loop, c, m->game_id, ERR_BAD_MESSAGE);
+  }
+}
+
+// a connection at no game here that sends a message for a game of another
+// loop moves there, with that message and any input after it still to
+// handle, so each game's seats all sit on the loop that owns it
+static bool move_to_owner(Loop *loop, Connection *c, const Message *m) {
+  Loop *owner = owner_of(m->game_id);
+  if (m->type == MSG_NEW_GAME || !owner || owner == loop || c->game_count > 0) {
+    return false;
+  }
+  c->moving_to = owner;
+  c->next_moving = loop->moving;
+  loop->moving = c;
+  return true;
+}
+
+// handles every whole message in c's input buffer
+static void handle_input(Loop *loop, Connection *c) {
+  size_t used = 0;
+  for (;;) {
+    Message m;
+    int length = message_decode(c->in + used, c->in_length - used, &m);
+    if (length == 0) {
+      break;
+    }
+    if (length < 0) {
+      // the stream cannot be resynchronised after a bad frame
+      send_error(loop, c, 0, ERR_BAD_MESSAGE);
+      flush_output(loop, c);
+      close_later(loop, c);
+      return;
+    }
+    if (move_to_owner(loop, c, &m)) {
+      break;
+    }
+    handle_message(loop, c, &m);
+    used += length;
+  }
+  memmove(c->in, c->in + used, c->in_length - used);
+  c->in_length -= used;
+}
+
+static void read_input(Loop *loop, Connection *c) {
+  for (;;) {
+    ssize_t n = read(c->fd, c->in + c->in_length, sizeof(c->in) - c->in_length);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      close_later(loop, c);
+      return;
+    }
+    if (n < 0) {
+      break;
+    }
+    c->in_length += n;
+    handle_input(loop, c);
+    // the rest of the input is read by the loop it moves to
+    if (c->closing || c->moving_to) {
+      return;
+    }
+  }
+}
+
+// passes c on to the loop it is moving to, once its output was flushed here
+static void hand_over(Loop *loop, Connection *c) {
+  Loop *to = c->moving_to;
+  poller_remove(loop->poll_fd, c->fd);
+  count(&loop->connections, -1);
+  pthread_mutex_lock(&to->arrivals_lock);
+  c->next_moving = to->arrivals;
+  to->arrivals = c;
+  pthread_mutex_unlock(&to->arrivals_lock);
+  waker_signal(to);
+}
+
+// takes on the connections other loops handed over
+static void receive_arrivals(Loop *loop) {
+  waker_drain(loop);
+  pthread_mutex_lock(&loop->arrivals_lock);
+  Connection *arrivals = loop->arrivals;
+  loop->arrivals = NULL;
+  pthread_mutex_unlock(&loop->arrivals_lock);
+  while (arrivals) {
+    Connection *c = arrivals;
+    arrivals = c->next_moving;
+    c->moving_to = NULL;
+    count(&loop->connections, 1);
+    if (!poller_add(loop->poll_fd, c->fd, c)) {
+      close_later(loop, c);
+      continue;
+    }
+    c->want_write = c->out_length > 0;
+    if (c->want_write) {
+      poller_want_write(loop->poll_fd, c->fd, c, true);
+    }
+    handle_input(loop, c);
+  }
+}
+
+static void accept_connections(Loop *loop) {
+  for (;;) {
+    int fd = accept(loop->listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    int one = 1;
+    // moves are tiny and latency bound, never wait to batch them
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    Connection *c = calloc(1, sizeof(Connection));
+    if (!c || !set_nonblocking(fd) || !poller_add(loop->poll_fd, fd, c)) {
+      free(c);
+      close(fd);
+      continue;
+    }
+    c->fd = fd;
+    count(&loop->connections, 1);
+  }
+}
+
+static void close_connection(Loop *loop, Connection *c) {
+  // a connection rarely sits at many games, but it may sit at thousands
+  // when it drives a load test, so the scan only runs when it has any
+  for (int i = 0; i < loop->game_count && c->game_count > 0; i++) {
+    if (loop->games[i].in_use) {
+      leave_game(loop, &loop->games[i], c);
+    }
+  }
+  close(c->fd);
+  free(c->out);
+  free(c);
+  count(&loop->connections, -1);
+}
+
+static void *run_loop(void *arg) {
+  Loop *loop = arg;
+  PollEvent events[MAX_EVENTS];
+  for (;;) {
+    int ready = poller_wait(loop->poll_fd, events, MAX_EVENTS, POLL_TIMEOUT_MS);
+    if (ready < 0 && errno != EINTR) {
+      perror("poll");
+      exit(1);
+    }
+    for (int i = 0; i < ready; i++) {
+      void *data = event_data(&events[i]);
+      if (data == LISTENER) {
+        accept_connections(loop);
+        continue;
+      }
+      if (data == WAKER) {
+        receive_arrivals(loop);
+        continue;
+      }
+      Connection *c = data;
+      if (c->closing || c->moving_to) {
+        continue;
+      }
+      if (event_readable(&events[i])) {
+        read_input(loop, c);
+      }
+      if (event_writable(&events[i]) && !c->closing) {
+        flush_output(loop, c);
+      }
+    }
+    while (loop->flush) {
+      Connection *c = loop->flush;
+      loop->flush = c->next_flush;
+      c->flush_queued = false;
+      if (!c->closing) {
+        flush_output(loop, c);
+      }
+    }
+    while (loop->moving) {
+      Connection *c = loop->moving;
+      loop->moving = c->next_moving;
+      if (!c->closing) {
+        hand_over(loop, c);
+      }
+    }
+    while (loop->closing) {
+      Connection *c = loop->closing;
+      loop->closing = c->next_closing;
+      close_connection(loop, c);
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  int port = argc > 1 ? atoi(argv[1]) : DEFAULT_PORT;
+  loop_count = argc > 2 ? atoi(argv[2]) : 1;
+  if (port <= 0 || port > 65535 || loop_count < 1 || loop_count > MAX_LOOPS) {
+    fprintf(stderr, "usage: %s [port] [event loops 1-%d]\n", argv[0], MAX_LOOPS);
+    return 2;
+  }
+  // a client closing early must not kill the server on the next write
+  signal(SIGPIPE, SIG_IGN);
+  while ((1 << loop_bits) < loop_count) {
+    loop_bits++;
+  }
+  for (int i = 0; i < loop_count; i++) {
+    Loop *loop = &loops[i];
+    loop->index = i;
+    loop->free_games = -1;
+    pthread_mutex_init(&loop->arrivals_lock, NULL);
+    loop->listen_fd = open_listener(port, loop_count > 1);
+    loop->poll_fd = poller_create();
+    if (loop->listen_fd < 0 || loop->poll_fd < 0 || !waker_create(loop->wake_fds) ||
+        !poller_add(loop->poll_fd, loop->listen_fd, LISTENER) ||
+        !poller_add(loop->poll_fd, loop->wake_fds[0], WAKER)) {
+      fprintf(stderr, "could not listen on port %d: %s\n", port, strerror(errno));
+      return 1;
+    }
+  }
+  // every game lives on the loop that created it, one per thread, and
+  // joining it moves the joining connection to that loop
+  for (int i = 0; i < loop_count; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, run_loop, &loops[i]) != 0) {
+      fprintf(stderr, "could not start event loop %d\n", i);
+      return 1;
+    }
+    pthread_detach(thread);
+  }
+  printf("listening on port %d with %d event loop%s\n", port, loop_count, loop_count > 1 ? "s" : "");
+  fflush(stdout);
+  uint64_t last_moves = 0;
+  for (;;) {
+    sleep(STATS_INTERVAL);
+    uint64_t connections = 0, live = 0, started = 0, moves = 0;
+    for (int i = 0; i < loop_count; i++) {
+      connections += __atomic_load_n(&loops[i].connections, __ATOMIC_RELAXED);
+      live += __atomic_load_n(&loops[i].live_games, __ATOMIC_RELAXED);
+      started += __atomic_load_n(&loops[i].games_started, __ATOMIC_RELAXED);
+      moves += __atomic_load_n(&loops[i].moves, __ATOMIC_RELAXED);
+    }
+    if (moves != last_moves) {
+      printf("%llu connections, %llu live games, %llu games started, %.0f moves/s\n",
+             (unsigned long long)connections, (unsigned long long)live,
+             (unsigned long long)started, (double)(moves - last_moves) / STATS_INTERVAL);
+      fflush(stdout);
+      last_moves = moves;
+    }
+  }
+}
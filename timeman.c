@@ -0,0 +1,48 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "timeman.h"
+
+double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double clock_now(const SearchClock *clock) {
+  return clock ? clock->now(clock->user) : now_seconds();
+}
+
+TimeBudget time_budget(const TimeControl *tc, int root_moves, bool forced_capture) {
+  double usable = tc->remaining - TIME_MOVE_OVERHEAD;
+  if (usable < 0) {
+    usable = 0;
+  }
+  int moves_to_go = tc->moves_to_go > 0 ? tc->moves_to_go : TIME_DEFAULT_MOVES_TO_GO;
+  TimeBudget budget = {
+    .soft = usable / moves_to_go + tc->increment,
+  };
+  if (forced_capture) {
+    budget.soft *= TIME_FORCED_CAPTURE_SHARE;
+  }
+  budget.hard = budget.soft * TIME_HARD_FACTOR;
+  // the last move before the control may use what is left, any other
+  // keeps some for the moves after it
+  double cap = tc->moves_to_go == 1 ? usable : usable * TIME_HARD_SHARE;
+  if (budget.hard > cap) {
+    budget.hard = cap;
+  }
+  if (budget.soft > budget.hard) {
+    budget.soft = budget.hard;
+  }
+  // a single legal move needs no thought, the first iteration only
+  // gives it a score and the hard deadline still bounds that
+  if (root_moves <= 1) {
+    budget.soft = 0;
+  }
+  return budget;
+}
+
+double time_soft_deadline(const TimeBudget *budget, double instability) {
+  double soft = budget->soft * (1 + TIME_INSTABILITY_FACTOR * instability);
+  return soft < budget->hard ? soft : budget->hard;
+}
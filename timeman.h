@@ -0,0 +1,56 @@
+#ifndef TIMEMAN_H
+#define TIMEMAN_H
+
+#include <stdbool.h>
+
+// moves a sudden death clock is assumed to still have to cover
+#define TIME_DEFAULT_MOVES_TO_GO 30
+// kept back on every move for the time it takes to send it
+#define TIME_MOVE_OVERHEAD 0.05
+// the hard deadline is at most this many soft budgets
+#define TIME_HARD_FACTOR 4.0
+// and never more than this share of the time left
+#define TIME_HARD_SHARE 0.5
+// each change of the best move recently adds this share of the soft budget
+#define TIME_INSTABILITY_FACTOR 0.5
+// soft budget share when every root move is a capture, the move is
+// mostly forced and the position simple
+#define TIME_FORCED_CAPTURE_SHARE 0.25
+
+// where the search reads the time from, seconds since any fixed point,
+// tests pass their own to step through deadlines without sleeping
+typedef struct SearchClock {
+  double (*now)(void *user);
+  void *user;
+} SearchClock;
+
+// the clock of the side to move
+typedef struct TimeControl {
+  // seconds left
+  double remaining;
+  // seconds added once the move is made
+  double increment;
+  // moves until more time is added, 0 for sudden death
+  int moves_to_go;
+} TimeControl;
+
+// seconds from the start of the move: no new iteration is started after
+// the soft deadline, the search is stopped at the hard one
+typedef struct TimeBudget {
+  double soft;
+  double hard;
+} TimeBudget;
+
+// the monotonic wall clock in seconds, also what the tools time runs with
+double now_seconds(void);
+// clock->now, or the monotonic wall clock without a clock
+double clock_now(const SearchClock *clock);
+
+// budget for a move with tc on the clock, root_moves legal moves of
+// which all are captures when forced_capture is set
+TimeBudget time_budget(const TimeControl *tc, int root_moves, bool forced_capture);
+// soft budget after the best move changed instability times recently,
+// still within the hard deadline
+double time_soft_deadline(const TimeBudget *budget, double instability);
+
+#endif
@@ -0,0 +1,155 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "board.h"
+#include "moves.h"
+#include "search.h"
+#include "timeman.h"
+
+#define CHECK_HASH_MB 16
+// every read of the fake clock moves it on by this much, the search reads
+// it once per TIME_CHECK_INTERVAL nodes so a deadline is a node count
+#define CLOCK_STEP 0.001
+
+// one legal move, a capture, with plenty left to search after it
+#define SINGLE_MOVE_FEN "B:W12,15,21,23,24,25,28,29,30,31,32:B1,2,3,4,5,6,7,8,11"
+// three captures and nothing else to play
+#define FORCED_CAPTURE_FEN "B:W19,20,22,26,27,28,29,31,32:B1,3,4,5,6,8,11,12,15,16,K25"
+
+typedef struct SteppedClock {
+  double now;
+  int reads;
+} SteppedClock;
+
+static double stepped_now(void *user) {
+  SteppedClock *c = user;
+  c->reads++;
+  return c->now += CLOCK_STEP;
+}
+
+static int failures;
+
+static void check(bool ok, const char *what) {
+  printf("%-64s %s\n", what, ok ? "ok" : "FAIL");
+  failures += !ok;
+}
+
+static bool near(double a, double b) {
+  return fabs(a - b) < 1e-9;
+}
+
+static bool budget_is(TimeControl tc, int root_moves, bool forced_capture, double soft, double hard) {
+  TimeBudget budget = time_budget(&tc, root_moves, forced_capture);
+  return near(budget.soft, soft) && near(budget.hard, hard);
+}
+
+static void check_budgets(void) {
+  double usable = 60 - TIME_MOVE_OVERHEAD;
+  double soft = usable / TIME_DEFAULT_MOVES_TO_GO;
+  check(budget_is((TimeControl){60, 0, 0}, 10, false, soft, soft * TIME_HARD_FACTOR),
+        "sudden death splits the clock over the default moves to go");
+  check(budget_is((TimeControl){60, 1, 0}, 10, false, soft + 1, (soft + 1) * TIME_HARD_FACTOR),
+        "the increment is added to the soft budget");
+  check(budget_is((TimeControl){60, 0, 10}, 10, false, usable / 10, usable / 10 * TIME_HARD_FACTOR),
+        "moves to go replace the default");
+  check(budget_is((TimeControl){10, 0, 1}, 10, false, 10 - TIME_MOVE_OVERHEAD, 10 - TIME_MOVE_OVERHEAD),
+        "the last move before the control may use all of it");
+  double share = (2 - TIME_MOVE_OVERHEAD) * TIME_HARD_SHARE;
+  check(budget_is((TimeControl){2, 10, 0}, 10, false, share, share),
+        "a large increment is held to the hard share of the clock");
+  check(budget_is((TimeControl){0.01, 0, 0}, 10, false, 0, 0), "a clock below the move overhead gives nothing");
+  check(budget_is((TimeControl){60, 0, 0}, 1, false, 0, soft * TIME_HARD_FACTOR),
+        "a single legal move has no soft budget");
+  double forced = soft * TIME_FORCED_CAPTURE_SHARE;
+  check(budget_is((TimeControl){60, 0, 0}, 3, true, forced, forced * TIME_HARD_FACTOR),
+        "forced captures get a share of the budget");
+}
+
+static void check_instability(void) {
+  TimeBudget budget = {.soft = 1, .hard = 4};
+  check(near(time_soft_deadline(&budget, 0), 1), "a settled best move keeps the soft deadline");
+  check(near(time_soft_deadline(&budget, 1), 1 + TIME_INSTABILITY_FACTOR), "a changed best move extends it");
+  check(near(time_soft_deadline(&budget, 100), 4), "the extension stops at the hard deadline");
+}
+
+// searches fen on a fresh stepped clock with tc, or to max_depth without one
+static SearchResult timed_search(const char *fen, const TimeControl *tc, int max_depth, SteppedClock *clock) {
+  GameState game;
+  game_init(&game);
+  if (fen && !game_set_fen(&game, fen)) {
+    fprintf(stderr, "invalid fen: %s\n", fen);
+    exit(2);
+  }
+  *clock = (SteppedClock){0};
+  SearchClock search_clock = {.now = stepped_now, .user = clock};
+  SearchLimits limits = {.max_depth = max_depth, .time_control = tc, .clock = &search_clock};
+  SearchResult result;
+  search_clear_hash();
+  search(&game, limits, &result);
+  return result;
+}
+
+static bool is_legal(const char *fen, const Move *m) {
+  GameState game;
+  game_init(&game);
+  if (fen) {
+    game_set_fen(&game, fen);
+  }
+  MoveList moves;
+  generate_moves(&game, &moves);
+  for (int i = 0; i < moves.count; i++) {
+    const Move *legal = &moves.moves[i];
+    if (legal->from == m->from && legal->to == m->to && legal->captured == m->captured) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void check_searches(void) {
+  SteppedClock clock;
+  TimeControl tc = {60, 0, 0};
+
+  SearchResult untimed = timed_search(SINGLE_MOVE_FEN, NULL, 6, &clock);
+  SearchResult single = timed_search(SINGLE_MOVE_FEN, &tc, 0, &clock);
+  check(untimed.depth == 6 && single.has_move && single.depth == 1 && single.elapsed < single.budget.hard,
+        "a single legal move is played after depth 1");
+
+  SearchResult forced = timed_search(FORCED_CAPTURE_FEN, &tc, 8, &clock);
+  TimeBudget free_choice = time_budget(&tc, 3, false);
+  check(near(forced.budget.soft, free_choice.soft * TIME_FORCED_CAPTURE_SHARE),
+        "forced captures at the root shrink the soft budget");
+
+  SearchResult settled = timed_search(NULL, &tc, 0, &clock);
+  check(settled.has_move && settled.elapsed >= settled.budget.soft && settled.elapsed < settled.budget.hard,
+        "a search stops between its soft and hard deadlines");
+
+  // the last move before the control has its soft deadline on the hard
+  // one, so only the hard deadline can end the iteration running then
+  TimeControl last_move = {0.2 + TIME_MOVE_OVERHEAD, 0, 1};
+  SearchResult cut = timed_search(NULL, &last_move, 0, &clock);
+  check(cut.has_move && is_legal(NULL, &cut.best_move) && cut.elapsed >= cut.budget.hard &&
+            cut.elapsed < cut.budget.hard + 3 * CLOCK_STEP,
+        "a search is stopped at its hard deadline with a move to play");
+  printf("hard deadline %.3f s, stopped at %.3f s in depth %d after %d clock reads\n", cut.budget.hard, cut.elapsed,
+         cut.depth + 1, clock.reads);
+}
+
+// timeman_check
+// drives the time manager and search on a fake clock, every deadline is
+// then hit at the same node each run, exits non zero on a failed check
+int main(void) {
+  if (!search_init(CHECK_HASH_MB)) {
+    fprintf(stderr, "could not allocate a %d MB hash table\n", CHECK_HASH_MB);
+    return 1;
+  }
+  check_budgets();
+  check_instability();
+  check_searches();
+  if (failures) {
+    printf("%d time manager checks failed\n", failures);
+    return 1;
+  }
+  printf("every time manager check passed\n");
+  return 0;
+}
@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include "tt.h"
+
+#define HASHFULL_SAMPLE_BUCKETS 250
+
+// data layout: score 0-15, depth 16-23, bound 24-25, move 32-39, generation 40-47
+static inline uint64_t pack_data(int score, int depth, TTBound bound, int move_index, uint8_t generation) {
+  return (uint64_t)(uint16_t)(int16_t)score |
+         (uint64_t)(uint8_t)depth << 16 |
+         (uint64_t)bound << 24 |
+         (uint64_t)(uint8_t)move_index << 32 |
+         (uint64_t)generation << 40;
+}
+
+static inline int data_score(uint64_t data) {
+  return (int16_t)(data & 0xFFFF);
+}
+
+static inline int data_depth(uint64_t data) {
+  return (data >> 16) & 0xFF;
+}
+
+static inline TTBound data_bound(uint64_t data) {
+  return (TTBound)((data >> 24) & 0x3);
+}
+
+static inline int data_move(uint64_t data) {
+  return (data >> 32) & 0xFF;
+}
+
+static inline uint8_t data_generation(uint64_t data) {
+  return (data >> 40) & 0xFF;
+}
+
+// entries are read and written one word at a time without locks,
+// relaxed atomics keep each word whole
+static inline uint64_t load_word(const uint64_t *p) {
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static inline void store_word(uint64_t *p, uint64_t v) {
+  __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+
+static inline TTBucket *bucket_for(const TranspositionTable *tt, uint64_t key) {
+  return &tt->buckets[key & (tt->bucket_count - 1)];
+}
+
+bool tt_init(TranspositionTable *tt, size_t megabytes) {
+  size_t bytes = megabytes * 1024 * 1024;
+  size_t count = 1;
+  while (count * 2 * sizeof(TTBucket) <= bytes) {
+    count *= 2;
+  }
+  void *memory = NULL;
+  if (posix_memalign(&memory, TT_CACHE_LINE, count * sizeof(TTBucket)) != 0) {
+    return false;
+  }
+  tt->buckets = memory;
+  tt->bucket_count = count;
+  tt_clear(tt);
+  return true;
+}
+
+void tt_free(TranspositionTable *tt) {
+  free(tt->buckets);
+  tt->buckets = NULL;
+  tt->bucket_count = 0;
+}
+
+void tt_clear(TranspositionTable *tt) {
+  memset(tt->buckets, 0, tt->bucket_count * sizeof(TTBucket));
+  tt->generation = 0;
+}
+
+void tt_new_search(TranspositionTable *tt) {
+  tt->generation++;
+}
+
+bool tt_probe(const TranspositionTable *tt, uint64_t key, TTHit *hit) {
+  if (!tt->buckets) {
+    return false;
+  }
+  TTBucket *bucket = bucket_for(tt, key);
+  for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+    TTEntry *e = &bucket->entries[i];
+    uint64_t data = load_word(&e->data);
+    if ((load_word(&e->key) ^ data) == key && data_bound(data) != TT_NONE) {
+      hit->score = data_score(data);
+      hit->depth = data_depth(data);
+      hit->bound = data_bound(data);
+      hit->move_index = data_move(data);
+      return true;
+    }
+  }
+  return false;
+}
+
+void tt_store(TranspositionTable *tt, uint64_t key, int depth, TTBound bound,
+              int score, int move_index) {
+  if (!tt->buckets) {
+    return;
+  }
+  TTBucket *bucket = bucket_for(tt, key);
+  TTEntry *replace = NULL;
+  int replace_worth = 0;
+  for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+    TTEntry *e = &bucket->entries[i];
+    uint64_t data = load_word(&e->data);
+    if ((load_word(&e->key) ^ data) == key) {
+      // keep the old best move when this search found none
+      if (move_index == TT_NO_MOVE) {
+        move_index = data_move(data);
+      }
+      replace = e;
+      break;
+    }
+    // prefer empty, then stale, then shallow entries
+    int worth = data_depth(data) - 8 * (uint8_t)(tt->generation - data_generation(data));
+    if (data_bound(data) == TT_NONE) {
+      worth = -1000;
+    }
+    if (!replace || worth < replace_worth) {
+      replace = e;
+      replace_worth = worth;
+    }
+  }
+  uint64_t data = pack_data(score, depth, bound, move_index, tt->generation);
+  store_word(&replace->data, data);
+  store_word(&replace->key, key ^ data);
+}
+
+int tt_hashfull(const TranspositionTable *tt) {
+  if (!tt->buckets) {
+    return 0;
+  }
+  size_t sample = tt->bucket_count < HASHFULL_SAMPLE_BUCKETS ? tt->bucket_count : HASHFULL_SAMPLE_BUCKETS;
+  int used = 0;
+  for (size_t b = 0; b < sample; b++) {
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+      uint64_t data = load_word(&tt->buckets[b].entries[i].data);
+      if (data_bound(data) != TT_NONE && data_generation(data) == tt->generation) {
+        used++;
+      }
+    }
+  }
+  return used * 1000 / (int)(sample * TT_BUCKET_SIZE);
+}
@@ -0,0 +1,61 @@
+#ifndef TT_H
+#define TT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// four 16 byte entries fill one 64 byte cache line
+#define TT_BUCKET_SIZE 4
+#define TT_CACHE_LINE 64
+#define TT_NO_MOVE 0xFF
+
+typedef enum TTBound {
+  TT_NONE,
+  TT_UPPER,
+  TT_LOWER,
+  TT_EXACT,
+} TTBound;
+
+// key holds the position hash xor data, so a torn write from another
+// thread fails verification instead of returning mixed up fields
+typedef struct TTEntry {
+  uint64_t key;
+  uint64_t data;
+} TTEntry;
+
+typedef struct TTBucket {
+  TTEntry entries[TT_BUCKET_SIZE];
+} TTBucket;
+
+typedef struct TranspositionTable {
+  TTBucket *buckets;
+  // always a power of two
+  size_t bucket_count;
+  uint8_t generation;
+} TranspositionTable;
+
+typedef struct TTHit {
+  int score;
+  int depth;
+  TTBound bound;
+  // index of the best move in generate_moves order or TT_NO_MOVE
+  int move_index;
+} TTHit;
+
+// allocates the largest power of two bucket count that fits in megabytes
+bool tt_init(TranspositionTable *tt, size_t megabytes);
+void tt_free(TranspositionTable *tt);
+void tt_clear(TranspositionTable *tt);
+// ages every entry so stale results are replaced first
+void tt_new_search(TranspositionTable *tt);
+
+// safe to call from many threads at once without locking
+bool tt_probe(const TranspositionTable *tt, uint64_t key, TTHit *hit);
+void tt_store(TranspositionTable *tt, uint64_t key, int depth, TTBound bound,
+              int score, int move_index);
+
+// permille of sampled entries written by the current search
+int tt_hashfull(const TranspositionTable *tt);
+
+#endif
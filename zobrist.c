@@ -0,0 +1,44 @@
+#include "zobrist.h"
+
+#define ZOBRIST_SEED 0x636865636b657273ULL
+
+uint64_t zobrist_piece_keys[PLAYER_COUNT][2][SQUARE_COUNT];
+uint64_t zobrist_side_key;
+
+static bool zobrist_ready = false;
+
+static uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+void zobrist_init(void) {
+  if (zobrist_ready) {
+    return;
+  }
+  uint64_t state = ZOBRIST_SEED;
+  for (int p = 0; p < PLAYER_COUNT; p++) {
+    for (int t = PAWN; t <= KING; t++) {
+      for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+        zobrist_piece_keys[p][t][sq] = splitmix64(&state);
+      }
+    }
+  }
+  zobrist_side_key = splitmix64(&state);
+  zobrist_ready = true;
+}
+
+uint64_t compute_hash(const GameState *game) {
+  uint64_t h = 0;
+  for (int p = 0; p < PLAYER_COUNT; p++) {
+    h ^= zobrist_pieces(p, PAWN, game->players[p].men);
+    h ^= zobrist_pieces(p, KING, game->players[p].kings);
+  }
+  // the key is folded in when player one is to move
+  if (game->current_player == PLAYER_ONE) {
+    h ^= zobrist_side_key;
+  }
+  return h;
+}
@@ -0,0 +1,28 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <stdint.h>
+#include "board.h"
+
+// keys are generated from a fixed seed, so hashes are stable across runs
+// and can be stored on disk
+extern uint64_t zobrist_piece_keys[PLAYER_COUNT][2][SQUARE_COUNT];
+extern uint64_t zobrist_side_key;
+
+// fills the key tables, called by game_init and game_set_fen
+// must run once before any threads are started
+void zobrist_init(void);
+
+// full hash of a position, used when a state is set up from scratch
+uint64_t compute_hash(const GameState *game);
+
+static inline uint64_t zobrist_pieces(int player_idx, PieceType type, Bitboard pieces) {
+  uint64_t h = 0;
+  while (pieces) {
+    h ^= zobrist_piece_keys[player_idx][type][__builtin_ctz(pieces)];
+    pieces &= pieces - 1;
+  }
+  return h;
+}
+
+#endif